@@ -2,33 +2,96 @@
 #include "descriptor_parser.h"
 #include "usb_transfer.h"
 #include "usb_hid.h"
+#include "rumble.h"
+#include "gamepad.h"
+#include "mouse.h"
+#include "runtime_params.h"
+#include "telemetry.h"
+#include "joybus_sniffer.h"
 #include "debug_print.h"
+#include "messages.h"
+#include "stack_monitor.h"
+#include "timebase.h"
 
 struct HidInfo gHid;
+struct N64ControllerState gController;
+struct PeriodicTask gPollTask;
 
 void setup() {
+  timeInit();
+
+#if JOYBUS_SNIFFER
+  snifferInit();
+  return;
+#endif
+
   pinMode(2, INPUT); // N64
 
   pinMode(13, OUTPUT);
 
   uint8_t version = usbUnit();
 
+#if DEBUG_SERIAL
   Serial.begin(9600);
+#elif TELEMETRY
+  telemetryInit();
+#endif
 
-  Serial.write("GET_IC_VER: 0x");
-  printHex(version);
-  Serial.write("\n");
+  printMessageHex(MessageIcVersion, version);
+  printStackReport();
 
-  // needs to work wouth TIMSK0
+  // needs to work wouth TIMSK0, timing comes from timebase.h instead
   TIMSK0 = 0;
+
+  periodicTaskInit(&gPollTask, usbPollPeriod(&gHid));
 }
 
 
 void loop() {
+#if JOYBUS_SNIFFER
+  snifferUpdate();
+  return;
+#endif
+
+#if TELEMETRY
+  telemetryUpdate();
+#endif
+
   checkUsbInterupts(&gHid);
 
-  char mouseData[8];
-  if (usbPollMouse(&gHid, mouseData)) {
-    debugPrintBuffer(mouseData, 3);
+  struct RuntimeParams* params = runtimeParams();
+
+  // polling faster than the device's bInterval only collects NAKs
+  if (params->pollIntervalMs) {
+    gPollTask.period = TIME_MS(params->pollIntervalMs);
+  } else {
+    gPollTask.period = usbPollPeriod(&gHid);
   }
+
+  if (!periodicTaskDue(&gPollTask)) {
+    return;
+  }
+
+  struct ReportValues report;
+
+  if (usbPollMouse(&gHid, &report)) {
+    if (gHid.deviceType == HID_DEVICE_TYPE_GAMEPAD) {
+      gamepadTranslate(&gHid, &report, &gController);
+    } else {
+      mouseTranslate(&report, params->sensitivity, &gController);
+    }
+
+#if TELEMETRY
+    if (params->streamReports) {
+      telemetrySendReport(gHid.deviceType, &gController);
+    }
+#else
+    debugPrintBuffer((uint8_t*)&gController, sizeof(gController));
+#endif
+  }
+
+#if RUMBLE
+  // output reports go after the poll so they never delay input
+  rumbleUpdate(&gHid);
+#endif
 }
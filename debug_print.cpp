@@ -1,8 +1,9 @@
 #include "debug_print.h"
 
 #include <Arduino.h>
+#include <avr/pgmspace.h>
 
-char gHexCharacter[] = {
+const char gHexCharacter[] PROGMEM = {
   '0', '1', '2', '3',
   '4', '5', '6', '7',
   '8', '9', 'A', 'B',
@@ -10,11 +11,14 @@ char gHexCharacter[] = {
 };
 
 void printHex(uint8_t value) {
-  Serial.write(gHexCharacter[value >> 4]);
-  Serial.write(gHexCharacter[value & 0xF]);
+#if DEBUG_SERIAL
+  Serial.write(pgm_read_byte(&gHexCharacter[value >> 4]));
+  Serial.write(pgm_read_byte(&gHexCharacter[value & 0xF]));
+#endif
 }
 
 void printBinary(uint8_t value) {
+#if DEBUG_SERIAL
   for (uint8_t i = 0; i < 8; ++i) {
     if (value & 0x80) {
       Serial.write('1');
@@ -24,9 +28,11 @@ void printBinary(uint8_t value) {
 
     value <<= 1;
   }
+#endif
 }
 
 void debugPrintBuffer(uint8_t* data, uint8_t bytes) {
+#if DEBUG_SERIAL
   for (uint8_t i = 0; i < bytes; ++i) {
     printHex(data[i]);
 
@@ -40,4 +46,5 @@ void debugPrintBuffer(uint8_t* data, uint8_t bytes) {
   if ((bytes & 0x7) != 0) {
     Serial.write('\n');
   }
+#endif
 }
\ No newline at end of file
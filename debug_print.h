@@ -3,7 +3,28 @@
 
 #include <stdint.h>
 
-#define DEBUG     1
+#include "usb_transfer.h"
+
+// binary frames from telemetry.h on the serial port instead of text
+#ifndef TELEMETRY
+#define TELEMETRY     0
+#endif
+
+#if USB_TRANSPORT == USB_TRANSPORT_UART
+#if TELEMETRY
+#error "telemetry needs the serial port, use USB_TRANSPORT_PARALLEL"
+#endif
+// the CH375B owns the serial port
+#define DEBUG_SERIAL  0
+#define DEBUG         0
+#elif TELEMETRY
+// text would corrupt the frames, messages go out as log frames instead
+#define DEBUG_SERIAL  0
+#define DEBUG         0
+#else
+#define DEBUG_SERIAL  1
+#define DEBUG         1
+#endif
 
 void printHex(uint8_t value);
 void printBinary(uint8_t value);
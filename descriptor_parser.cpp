@@ -7,6 +7,9 @@
 
 #include <Arduino.h>
 
+// wDescriptorLength of the first descriptor listed in the HID descriptor
+#define HID_DESC_REPORT_LENGTH_OFFSET   (offsetof(struct HidDescriptor, descriptors) + offsetof(struct HidDescriptorElement, wDescriptorLength))
+
 enum ConfigParserState {
     ConfigParserStateFindingInterfaceClass,
     ConfigParserStateFindingInterfaceSubClass,
@@ -22,6 +25,8 @@ struct ConfigParser {
     uint8_t descSize;
     uint8_t descType;
     uint8_t descOffset;
+    bool inEndpointPending;
+    uint8_t skippedInterfaces;
 
     struct HidInfo* info;
 };
@@ -32,9 +37,26 @@ void configParserInit(struct ConfigParser* parser, struct HidInfo* info) {
     parser->descType = 0;
     // size of header
     parser->descOffset = 2;
+    parser->inEndpointPending = false;
+    parser->skippedInterfaces = 0;
     parser->info = info;
 
     info->bootMouseEndpoint = 0;
+    info->pollInterval = 0;
+    info->outputEndpoint = 0;
+    info->reportDescriptorLength = 0;
+}
+
+void configParserFoundInterface(struct ConfigParser* parser, uint8_t deviceType) {
+    if (parser->skippedInterfaces < parser->info->interfaceSkip) {
+        // an earlier attempt couldn't use this one
+        ++parser->skippedInterfaces;
+        parser->state = ConfigParserStateFindingInterfaceClass;
+        return;
+    }
+
+    parser->info->deviceType = deviceType;
+    parser->state = ConfigParserStateFindingEndpoint;
 }
 
 void configParserStep(struct ConfigParser* parser, uint8_t next) {
@@ -48,6 +70,14 @@ void configParserStep(struct ConfigParser* parser, uint8_t next) {
         return;
     }
 
+    if (parser->state == ConfigParserStateFindingEndpoint &&
+        parser->descType == DESC_TYPE_INTERFACE &&
+        parser->descOffset == offsetof(struct InterfaceDescriptor, bInterfaceNumber) &&
+        parser->info->bootMouseEndpoint != 0) {
+        // the next interface started, stop looking for an output endpoint
+        parser->state = ConfigParserStateDone;
+    }
+
     if (parser->state != ConfigParserStateDone) {
         if (parser->descType == DESC_TYPE_CONFIGURATION &&
             parser->descOffset == offsetof(struct ConfigurationDescriptor, bConfigurationValue)) {
@@ -60,6 +90,14 @@ void configParserStep(struct ConfigParser* parser, uint8_t next) {
         }
     }
 
+    if (parser->inEndpointPending &&
+        parser->descType == DESC_TYPE_ENDPOINT &&
+        parser->descOffset == offsetof(struct EndpointDescriptor, bInterval)) {
+        // the input endpoint may have already finished the search
+        parser->info->pollInterval = next;
+        parser->inEndpointPending = false;
+    }
+
     switch (parser->state) {
         case ConfigParserStateFindingInterfaceClass:
             if (parser->descType == DESC_TYPE_INTERFACE && 
@@ -73,6 +111,9 @@ void configParserStep(struct ConfigParser* parser, uint8_t next) {
                 parser->descOffset == offsetof(struct InterfaceDescriptor, bInterfaceSubClass)) {
                 if (next == HID_SUBCLASS_BOOT) {
                     parser->state = ConfigParserStateFindingInterfaceProtocol;
+                } else if (next == HID_SUBCLASS_NONE) {
+                    // a generic device, the report descriptor decides if it can be used
+                    configParserFoundInterface(parser, HID_DEVICE_TYPE_GAMEPAD);
                 } else {
                     parser->state = ConfigParserStateFindingInterfaceClass;
                 }
@@ -82,17 +123,37 @@ void configParserStep(struct ConfigParser* parser, uint8_t next) {
             if (parser->descType == DESC_TYPE_INTERFACE &&
                 parser->descOffset == offsetof(struct InterfaceDescriptor, bInterfaceProtocol)) {
                 if (next == HID_PROTOCOL_MOUSE) {
-                    parser->state = ConfigParserStateFindingEndpoint;
+                    configParserFoundInterface(parser, HID_DEVICE_TYPE_MOUSE);
                 } else {
                     parser->state = ConfigParserStateFindingInterfaceClass;
                 }
             }
             break;
         case ConfigParserStateFindingEndpoint:
+            if (parser->descType == DESC_TYPE_HID &&
+                parser->descOffset == HID_DESC_REPORT_LENGTH_OFFSET) {
+                parser->info->reportDescriptorLength = next;
+            }
+
+            if (parser->descType == DESC_TYPE_HID &&
+                parser->descOffset == HID_DESC_REPORT_LENGTH_OFFSET + 1) {
+                parser->info->reportDescriptorLength |= (uint16_t)next << 8;
+            }
+
             if (parser->descType == DESC_TYPE_ENDPOINT &&
                 parser->descOffset == offsetof(struct EndpointDescriptor, bEndpointAddress)) {
-                parser->info->bootMouseEndpoint = next;
-                parser->state = ConfigParserStateDone;
+                if (next & ENDPOINT_DIRECTION_IN) {
+                    if (parser->info->bootMouseEndpoint == 0) {
+                        parser->info->bootMouseEndpoint = next;
+                        parser->inEndpointPending = true;
+                    }
+                } else if (parser->info->outputEndpoint == 0) {
+                    parser->info->outputEndpoint = next;
+                }
+
+                if (parser->info->bootMouseEndpoint != 0 && parser->info->outputEndpoint != 0) {
+                    parser->state = ConfigParserStateDone;
+                }
             }
     }
 
@@ -116,7 +177,7 @@ void packetDirectCopy(void* data, char* packetData, uint8_t packetSize, uint8_t
     memcpy((char*)data + offset, packetData, packetSize);
 }
 
-bool getHIDInfo(struct HidInfo* result) {
+bool getDeviceInfo(struct HidInfo* result) {
     char readBuffer[18]; 
     
     if (!readControlTransfer(
@@ -132,13 +193,26 @@ bool getHIDInfo(struct HidInfo* result) {
         return false;
     }
 
-    uint8_t bDeviceClass = ((struct DeviceDescriptor*)readBuffer)->bDeviceClass;
+    struct DeviceDescriptor* descriptor = (struct DeviceDescriptor*)readBuffer;
 
-    if (bDeviceClass != DEVICE_CLASS_DEVICE && bDeviceClass != DEVICE_CLASS_HID) {
-        // unsupported device
-        return false;
+    result->idVendor = descriptor->idVendor;
+    result->idProduct = descriptor->idProduct;
+    result->deviceClass = descriptor->bDeviceClass;
+
+    return true;
+}
+
+bool isSupportedDeviceClass(struct HidInfo* info) {
+    if (info->quirk.flags & QUIRK_IGNORE_DEVICE_CLASS) {
+        return true;
     }
 
+    return info->deviceClass == DEVICE_CLASS_DEVICE || info->deviceClass == DEVICE_CLASS_HID;
+}
+
+bool getHIDInfo(struct HidInfo* result) {
+    char readBuffer[sizeof(struct ConfigurationDescriptor)];
+
     uint8_t bNumConfigurations = 1;//((struct DeviceDescriptor*)readBuffer)->bNumConfigurations;
 
     for (uint8_t configurationIndex = 0; configurationIndex < bNumConfigurations; ++configurationIndex) {
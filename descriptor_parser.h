@@ -5,10 +5,13 @@
 #include <stdbool.h>
 
 #include "./usb_transfer.h"
+#include "./report_layout.h"
+#include "./quirks.h"
 
 #define DEVICE_CLASS_DEVICE         0x00
 #define DEVICE_CLASS_HID            0x03
 
+#define HID_SUBCLASS_NONE           0x00
 #define HID_SUBCLASS_BOOT           0x01
 
 #define HID_PROTOCOL_KEYBOARD       0x01
@@ -19,6 +22,8 @@
 #define DESC_TYPE_INTERFACE         0x04
 #define DESC_TYPE_ENDPOINT          0x05
 
+#define ENDPOINT_DIRECTION_IN       0x80
+
 #define DESC_TYPE_HID               0x21
 #define DESC_TYPE_REPORT            0x22
 #define DESC_TYPE_PHYSICAL          0x23
@@ -86,12 +91,39 @@ struct HidDescriptor {
     struct HidDescriptorElement descriptors[];
 };
 
+#define HID_DEVICE_TYPE_MOUSE       0x00
+#define HID_DEVICE_TYPE_GAMEPAD     0x01
+
 struct HidInfo {
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint8_t deviceClass;
+    // how the device deviates from the generic enumeration
+    struct DeviceQuirk quirk;
+    uint8_t deviceType;
+    // usable hid interfaces getHIDInfo passes over, counts up when an
+    // earlier one turns out not to be a mouse or gamepad
+    uint8_t interfaceSkip;
     uint8_t bootMouseConfiguration;
     uint8_t bootMouseInterface;
     uint8_t bootMouseEndpoint;
+    // bInterval of the input endpoint in ms
+    uint8_t pollInterval;
+    // interrupt OUT endpoint on the same interface, 0 if none
+    uint8_t outputEndpoint;
+    uint16_t reportDescriptorLength;
+    // 0 if the device has no output report that drives rumble
+    uint8_t outputReportLength;
+    uint8_t outputReportId;
+    struct ReportLayout layout;
+    struct ReportDecoder decoder;
 };
 
+// reads the device descriptor into idVendor, idProduct and deviceClass
+bool getDeviceInfo(struct HidInfo* result);
+bool isSupportedDeviceClass(struct HidInfo* info);
+// finds the hid interface in the configuration descriptor, skipping the
+// first interfaceSkip that could be used
 bool getHIDInfo(struct HidInfo* result);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "gamepad.h"
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#include "report_parser.h"
+
+#define HAT_CENTERED    8
+
+// hat values start at up and go clockwise
+const uint16_t gHatDirections[] PROGMEM = {
+  N64_BUTTON_D_UP,
+  N64_BUTTON_D_UP | N64_BUTTON_D_RIGHT,
+  N64_BUTTON_D_RIGHT,
+  N64_BUTTON_D_DOWN | N64_BUTTON_D_RIGHT,
+  N64_BUTTON_D_DOWN,
+  N64_BUTTON_D_DOWN | N64_BUTTON_D_LEFT,
+  N64_BUTTON_D_LEFT,
+  N64_BUTTON_D_UP | N64_BUTTON_D_LEFT,
+  0,
+};
+
+#define BUTTON_NIBBLE(a, b, c, d) { \
+  0,     (a),       (b),       (a)|(b), \
+  (c),   (a)|(c),   (b)|(c),   (a)|(b)|(c), \
+  (d),   (a)|(d),   (b)|(d),   (a)|(b)|(d), \
+  (c)|(d), (a)|(c)|(d), (b)|(c)|(d), (a)|(b)|(c)|(d), \
+}
+
+// every combination of each group of 4 hid buttons so a report is
+// translated with one lookup per nibble
+const uint16_t gButtonNibbles[MAX_BUTTON_COUNT / 4][16] PROGMEM = {
+  // buttons 1-4, face buttons
+  BUTTON_NIBBLE(N64_BUTTON_A, N64_BUTTON_B, N64_BUTTON_C_LEFT, N64_BUTTON_C_UP),
+  // buttons 5-8, shoulders and triggers
+  BUTTON_NIBBLE(N64_BUTTON_L, N64_BUTTON_R, N64_BUTTON_Z, N64_BUTTON_Z),
+  // buttons 9-12, select, start and stick clicks
+  BUTTON_NIBBLE(N64_BUTTON_C_DOWN, N64_BUTTON_START, 0, N64_BUTTON_C_RIGHT),
+  // buttons 13-16
+  BUTTON_NIBBLE(0, 0, 0, 0),
+};
+
+struct AxisCalibration gAxisCalibration[GamepadAxisCount];
+
+void gamepadCalibrateAxis(uint8_t axis, int32_t min, int32_t center, int32_t max, uint8_t deadzonePercent) {
+  struct AxisCalibration* calibration = &gAxisCalibration[axis];
+
+  int32_t halfRange = (max - min) >> 1;
+  uint8_t shift = 0;
+
+  while ((halfRange >> shift) > 127) {
+    ++shift;
+  }
+
+  uint8_t normalizedRange = (uint8_t)(halfRange >> shift);
+
+  if (normalizedRange == 0) {
+    normalizedRange = 1;
+  }
+
+  calibration->center = center;
+  calibration->shift = shift;
+  calibration->deadzone = (uint8_t)(((uint16_t)normalizedRange * deadzonePercent) / 100);
+  calibration->scale = (uint16_t)(((uint32_t)N64_STICK_RANGE << 8) / (normalizedRange - calibration->deadzone));
+}
+
+int8_t gamepadTranslateAxis(struct AxisCalibration* calibration, int32_t raw) {
+  int32_t relative = (raw - calibration->center) >> calibration->shift;
+
+  if (relative > 127) {
+    relative = 127;
+  } else if (relative < -127) {
+    relative = -127;
+  }
+
+  uint8_t magnitude = relative < 0 ? -relative : relative;
+
+  if (magnitude <= calibration->deadzone) {
+    return 0;
+  }
+
+  uint16_t scaled = ((uint32_t)(magnitude - calibration->deadzone) * calibration->scale) >> 8;
+
+  if (scaled > N64_STICK_RANGE) {
+    scaled = N64_STICK_RANGE;
+  }
+
+  if ((relative < 0) != calibration->invert) {
+    return -(int8_t)scaled;
+  }
+
+  return (int8_t)scaled;
+}
+
+bool gamepadInit(struct HidInfo* hidInfo) {
+  struct ReportLayout* layout = &hidInfo->layout;
+
+  // a relative mouse or a vendor interface would be read as sticks
+  if (layout->application != HID_USAGE_JOYSTICK && layout->application != HID_USAGE_GAMEPAD) {
+    return false;
+  }
+
+  if (!reportLayoutHasField(layout, ReportFieldX) && !reportLayoutHasField(layout, ReportFieldButtons)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < GamepadAxisCount; ++i) {
+    struct ReportField* field = &layout->fields[i];
+
+    if (field->bitSize != 0) {
+      gamepadCalibrateAxis(i, field->logicalMin, (field->logicalMin + field->logicalMax) >> 1, field->logicalMax, GAMEPAD_DEADZONE_PERCENT);
+    }
+  }
+
+  // hid y axes point down
+  gAxisCalibration[GamepadAxisY].invert = true;
+  gAxisCalibration[GamepadAxisRightY].invert = true;
+
+  return true;
+}
+
+void gamepadTranslate(struct HidInfo* hidInfo, struct ReportValues* values, struct N64ControllerState* state) {
+  struct ReportField* fields = hidInfo->layout.fields;
+  uint16_t buttons = 0;
+  int8_t axes[GamepadAxisCount];
+
+  for (uint8_t i = 0; i < GamepadAxisCount; ++i) {
+    axes[i] = fields[i].bitSize ? gamepadTranslateAxis(&gAxisCalibration[i], values->fields[i]) : 0;
+  }
+
+  if (fields[ReportFieldButtons].bitSize) {
+    uint16_t pressed = (uint16_t)values->fields[ReportFieldButtons];
+
+    buttons |= pgm_read_word(&gButtonNibbles[0][pressed & 0xF]);
+    buttons |= pgm_read_word(&gButtonNibbles[1][(pressed >> 4) & 0xF]);
+    buttons |= pgm_read_word(&gButtonNibbles[2][(pressed >> 8) & 0xF]);
+    buttons |= pgm_read_word(&gButtonNibbles[3][(pressed >> 12) & 0xF]);
+  }
+
+  if (fields[ReportFieldHat].bitSize) {
+    uint32_t hat = values->fields[ReportFieldHat] - fields[ReportFieldHat].logicalMin;
+
+    // out of range values are the null state
+    if (hat > HAT_CENTERED) {
+      hat = HAT_CENTERED;
+    }
+
+    buttons |= pgm_read_word(&gHatDirections[hat]);
+  }
+
+  if (axes[GamepadAxisRightX] >= GAMEPAD_C_BUTTON_THRESHOLD) {
+    buttons |= N64_BUTTON_C_RIGHT;
+  } else if (axes[GamepadAxisRightX] <= -GAMEPAD_C_BUTTON_THRESHOLD) {
+    buttons |= N64_BUTTON_C_LEFT;
+  }
+
+  if (axes[GamepadAxisRightY] >= GAMEPAD_C_BUTTON_THRESHOLD) {
+    buttons |= N64_BUTTON_C_UP;
+  } else if (axes[GamepadAxisRightY] <= -GAMEPAD_C_BUTTON_THRESHOLD) {
+    buttons |= N64_BUTTON_C_DOWN;
+  }
+
+  state->buttons = buttons;
+  state->stickX = axes[GamepadAxisX];
+  state->stickY = axes[GamepadAxisY];
+}
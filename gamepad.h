@@ -0,0 +1,40 @@
+#ifndef __GAMEPAD_H__
+#define __GAMEPAD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "descriptor_parser.h"
+#include "n64_controller.h"
+
+#define GAMEPAD_DEADZONE_PERCENT    12
+// how far the right stick has to move before it presses a c button
+#define GAMEPAD_C_BUTTON_THRESHOLD  (N64_STICK_RANGE / 2)
+
+// same order as the first entries of ReportFieldIndex
+enum GamepadAxis {
+  GamepadAxisX,
+  GamepadAxisY,
+  GamepadAxisRightX,
+  GamepadAxisRightY,
+
+  GamepadAxisCount,
+};
+
+struct AxisCalibration {
+  int32_t center;
+  // brings the raw range down to +-127 before scaling
+  uint8_t shift;
+  uint8_t deadzone;
+  // 8.8 fixed point, maps (127 - deadzone) to N64_STICK_RANGE
+  uint16_t scale;
+  bool invert;
+};
+
+// precomputes the translation for a connected device, returns false if
+// the device has nothing that can be mapped to a controller
+bool gamepadInit(struct HidInfo* hidInfo);
+void gamepadCalibrateAxis(uint8_t axis, int32_t min, int32_t center, int32_t max, uint8_t deadzonePercent);
+void gamepadTranslate(struct HidInfo* hidInfo, struct ReportValues* values, struct N64ControllerState* state);
+
+#endif
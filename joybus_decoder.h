@@ -0,0 +1,296 @@
+#ifndef __JOYBUS_DECODER_H__
+#define __JOYBUS_DECODER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// shared with tools/joybus_decode.c
+//
+// a capture is the time between each edge on the line in 0.5us ticks,
+// starting with the low of the first bit so lows and highs alternate.
+// A bit is 4us, a 1 is low for 1us and a 0 is low for 3us. Each message
+// ends with a stop bit.
+
+#define JOYBUS_TICKS_PER_US         2
+// lows shorter than this are a 1
+#define JOYBUS_ONE_MAX_TICKS        (2 * JOYBUS_TICKS_PER_US)
+// bytes kept from each message, enough for the command and a poll response
+#define JOYBUS_KEEP_BYTES           4
+// stats are reported and restarted after this many transactions so the
+// totals can't overflow, about a minute of polling at 60Hz
+#define JOYBUS_STATS_MAX_TRANSACTIONS   3600
+
+#define JOYBUS_CMD_STATUS           0x00
+#define JOYBUS_CMD_POLL             0x01
+#define JOYBUS_CMD_READ             0x02
+#define JOYBUS_CMD_WRITE            0x03
+#define JOYBUS_CMD_RESET            0xFF
+
+enum JoybusCommandIndex {
+  JoybusCommandStatus,
+  JoybusCommandPoll,
+  JoybusCommandRead,
+  JoybusCommandWrite,
+  JoybusCommandReset,
+  JoybusCommandOther,
+
+  JoybusCommandCount,
+};
+
+struct JoybusTransaction {
+  uint8_t command[JOYBUS_KEEP_BYTES];
+  uint8_t response[JOYBUS_KEEP_BYTES];
+  // not counting stop bits
+  uint16_t commandBits;
+  uint16_t responseBits;
+  // first edge to the last one
+  uint16_t durationTicks;
+  // from the end of the command's stop bit to the response
+  uint8_t responseDelayTicks;
+};
+
+struct JoybusDecoder {
+  struct JoybusTransaction* transaction;
+  uint16_t expectedCommandBits;
+  bool nextIsLow;
+  bool inResponse;
+  bool afterStop;
+  // a low in the response is only a bit once another high follows it,
+  // the last one is the stop bit
+  bool hasPendingLow;
+  uint8_t pendingLow;
+};
+
+struct JoybusSessionStats {
+  uint16_t transactions;
+  uint16_t commands[JoybusCommandCount];
+  uint16_t noResponse;
+  // the response length doesn't match the command
+  uint16_t badResponse;
+  // captures cut short because the ring was full
+  uint16_t truncated;
+  // transactions that started while the sniffer was busy
+  uint16_t missed;
+
+  // start to start of consecutive transactions
+  uint32_t minPeriodUs;
+  uint32_t maxPeriodUs;
+  uint32_t periodTotalUs;
+  uint16_t periodCount;
+  // sum of the change between consecutive periods
+  uint32_t jitterTotalUs;
+  // end of one transaction to the start of the next
+  uint32_t minIdleUs;
+  uint16_t maxBusyUs;
+  uint32_t busyTotalUs;
+
+  bool hasLast;
+  uint16_t lastStart;
+  uint16_t lastBusyUs;
+  uint32_t lastPeriodUs;
+};
+
+static inline uint8_t joybusCommandIndex(uint8_t command) {
+  switch (command) {
+    case JOYBUS_CMD_STATUS:
+      return JoybusCommandStatus;
+    case JOYBUS_CMD_POLL:
+      return JoybusCommandPoll;
+    case JOYBUS_CMD_READ:
+      return JoybusCommandRead;
+    case JOYBUS_CMD_WRITE:
+      return JoybusCommandWrite;
+    case JOYBUS_CMD_RESET:
+      return JoybusCommandReset;
+  }
+
+  return JoybusCommandOther;
+}
+
+static inline uint16_t joybusCommandBits(uint8_t command) {
+  switch (command) {
+    case JOYBUS_CMD_READ:
+      // command and address with crc
+      return 24;
+    case JOYBUS_CMD_WRITE:
+      // command, address and 32 bytes
+      return 280;
+  }
+
+  return 8;
+}
+
+// 0 if the command is unknown
+static inline uint16_t joybusResponseBits(uint8_t command) {
+  switch (command) {
+    case JOYBUS_CMD_STATUS:
+    case JOYBUS_CMD_RESET:
+      return 24;
+    case JOYBUS_CMD_POLL:
+      return 32;
+    case JOYBUS_CMD_READ:
+      // 32 bytes and a crc
+      return 264;
+    case JOYBUS_CMD_WRITE:
+      return 8;
+  }
+
+  return 0;
+}
+
+static inline void joybusPushBit(uint8_t* data, uint16_t* bits, bool bit) {
+  if (*bits < JOYBUS_KEEP_BYTES * 8) {
+    uint8_t mask = 0x80 >> (*bits & 0x7);
+
+    if (bit) {
+      data[*bits >> 3] |= mask;
+    } else {
+      data[*bits >> 3] &= ~mask;
+    }
+  }
+
+  ++*bits;
+}
+
+static inline void joybusDecoderInit(struct JoybusDecoder* decoder, struct JoybusTransaction* transaction) {
+  uint8_t i;
+
+  for (i = 0; i < JOYBUS_KEEP_BYTES; ++i) {
+    transaction->command[i] = 0;
+    transaction->response[i] = 0;
+  }
+
+  transaction->commandBits = 0;
+  transaction->responseBits = 0;
+  transaction->durationTicks = 0;
+  transaction->responseDelayTicks = 0;
+
+  decoder->transaction = transaction;
+  decoder->expectedCommandBits = 8;
+  decoder->nextIsLow = true;
+  decoder->inResponse = false;
+  decoder->afterStop = false;
+  decoder->hasPendingLow = false;
+  decoder->pendingLow = 0;
+}
+
+static inline void joybusDecoderEdge(struct JoybusDecoder* decoder, uint8_t ticks) {
+  struct JoybusTransaction* transaction = decoder->transaction;
+
+  transaction->durationTicks += ticks;
+
+  if (decoder->nextIsLow) {
+    decoder->nextIsLow = false;
+
+    if (decoder->inResponse) {
+      decoder->pendingLow = ticks;
+      decoder->hasPendingLow = true;
+    } else if (transaction->commandBits < decoder->expectedCommandBits) {
+      joybusPushBit(transaction->command, &transaction->commandBits, ticks < JOYBUS_ONE_MAX_TICKS);
+
+      // the first byte says how long the rest of the command is
+      if (transaction->commandBits == 8) {
+        decoder->expectedCommandBits = joybusCommandBits(transaction->command[0]);
+      }
+    } else {
+      // the command's stop bit
+      decoder->inResponse = true;
+      decoder->afterStop = true;
+    }
+
+    return;
+  }
+
+  decoder->nextIsLow = true;
+
+  if (decoder->afterStop) {
+    decoder->afterStop = false;
+    transaction->responseDelayTicks = ticks;
+  } else if (decoder->hasPendingLow) {
+    joybusPushBit(transaction->response, &transaction->responseBits, decoder->pendingLow < JOYBUS_ONE_MAX_TICKS);
+    decoder->hasPendingLow = false;
+  }
+}
+
+// anything still pending is the response's stop bit
+static inline void joybusDecoderFinish(struct JoybusDecoder* decoder) {
+  decoder->hasPendingLow = false;
+}
+
+static inline void joybusStatsReset(struct JoybusSessionStats* stats) {
+  uint8_t* bytes = (uint8_t*)stats;
+  uint16_t i;
+
+  for (i = 0; i < sizeof(struct JoybusSessionStats); ++i) {
+    bytes[i] = 0;
+  }
+}
+
+// start is when the transaction started in 4us ticks, consecutive
+// transactions have to be less than 262ms apart
+static inline void joybusStatsAdd(struct JoybusSessionStats* stats, uint16_t start, struct JoybusTransaction* transaction, bool truncated) {
+  uint16_t busyUs = transaction->durationTicks / JOYBUS_TICKS_PER_US;
+
+  ++stats->transactions;
+  ++stats->commands[joybusCommandIndex(transaction->command[0])];
+
+  if (truncated) {
+    ++stats->truncated;
+  } else if (transaction->responseBits == 0) {
+    ++stats->noResponse;
+  } else if (transaction->responseBits != joybusResponseBits(transaction->command[0])) {
+    ++stats->badResponse;
+  }
+
+  if (stats->hasLast) {
+    uint32_t periodUs = (uint32_t)(uint16_t)(start - stats->lastStart) * 4;
+    uint32_t idleUs = periodUs > stats->lastBusyUs ? periodUs - stats->lastBusyUs : 0;
+
+    if (stats->periodCount == 0 || periodUs < stats->minPeriodUs) {
+      stats->minPeriodUs = periodUs;
+    }
+
+    if (periodUs > stats->maxPeriodUs) {
+      stats->maxPeriodUs = periodUs;
+    }
+
+    if (stats->periodCount == 0 || idleUs < stats->minIdleUs) {
+      stats->minIdleUs = idleUs;
+    }
+
+    if (stats->periodCount > 0) {
+      stats->jitterTotalUs += periodUs > stats->lastPeriodUs ? periodUs - stats->lastPeriodUs : stats->lastPeriodUs - periodUs;
+    }
+
+    stats->periodTotalUs += periodUs;
+    stats->lastPeriodUs = periodUs;
+    ++stats->periodCount;
+  }
+
+  if (busyUs > stats->maxBusyUs) {
+    stats->maxBusyUs = busyUs;
+  }
+
+  stats->busyTotalUs += busyUs;
+
+  stats->hasLast = true;
+  stats->lastStart = start;
+  stats->lastBusyUs = busyUs;
+}
+
+static inline uint32_t joybusStatsAveragePeriodUs(struct JoybusSessionStats* stats) {
+  return stats->periodCount ? stats->periodTotalUs / stats->periodCount : 0;
+}
+
+// average change between consecutive periods
+static inline uint32_t joybusStatsJitterUs(struct JoybusSessionStats* stats) {
+  return stats->periodCount > 1 ? stats->jitterTotalUs / (stats->periodCount - 1) : 0;
+}
+
+// share of the time between the first and last transaction the line was busy
+static inline uint8_t joybusStatsBusyPercent(struct JoybusSessionStats* stats) {
+  uint32_t total = (stats->periodTotalUs + stats->lastBusyUs) / 100;
+  return total ? (uint8_t)(stats->busyTotalUs / total) : 0;
+}
+
+#endif
@@ -0,0 +1,422 @@
+#include "joybus_sniffer.h"
+
+#if JOYBUS_SNIFFER
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#define JOYBUS_PIN              (1 << 2)
+
+#define SNIFFER_RING_MASK       (SNIFFER_RING_SIZE - 1)
+
+// start(u16) edge count(u8) flags(u8), followed by the edges
+#define SNIFFER_RECORD_HEADER   4
+#define SNIFFER_RECORD_COUNT    2
+#define SNIFFER_RECORD_FLAGS    3
+
+// the ring filled up or the line stayed low
+#define SNIFFER_FLAG_TRUNCATED  0x01
+
+uint8_t gSnifferRing[SNIFFER_RING_SIZE];
+uint16_t gSnifferHead;
+uint16_t gSnifferTail;
+// progress through the record at the tail
+bool gSnifferTailDecoded;
+uint16_t gSnifferEmitPos;
+
+struct JoybusSessionStats gSnifferStats;
+bool gSnifferSessionActive;
+uint16_t gSnifferLastStart;
+
+// a finished set of stats being printed one field at a time
+struct JoybusSessionStats gSnifferReport;
+bool gSnifferReportPending;
+uint8_t gSnifferReportField;
+
+void snifferInit() {
+  pinMode(2, INPUT);
+
+  // the millis interrupt would delay the start of a capture
+  TIMSK0 = 0;
+
+  // Timer2 times the edges, F_CPU / 8 is 0.5us a tick
+  TCCR2A = 0;
+  TCCR2B = (1 << CS21);
+  TIMSK2 = 0;
+
+  // the interrupt is never enabled, the flag shows a falling edge came
+  // in while the loop was busy
+  EICRA = (EICRA & ~((1 << ISC01) | (1 << ISC00))) | (1 << ISC01);
+  EIMSK &= ~(1 << INT0);
+  EIFR = (1 << INTF0);
+
+  Serial.begin(SNIFFER_BAUD);
+}
+
+uint16_t snifferRingFree() {
+  return (gSnifferTail - gSnifferHead - 1) & SNIFFER_RING_MASK;
+}
+
+uint8_t snifferRingRead(uint16_t index) {
+  return gSnifferRing[index & SNIFFER_RING_MASK];
+}
+
+// call with interrupts off as soon as the line goes low
+void snifferCapture() {
+  uint8_t last = TCNT2;
+  uint16_t start = timeNowFromISR();
+
+  gSnifferLastStart = start;
+
+  uint16_t free = snifferRingFree();
+
+  if (free <= SNIFFER_RECORD_HEADER) {
+    if (gSnifferSessionActive) {
+      ++gSnifferStats.missed;
+    }
+    return;
+  }
+
+  uint8_t space = free - SNIFFER_RECORD_HEADER > 0xFF ? 0xFF : free - SNIFFER_RECORD_HEADER;
+  uint16_t index = (gSnifferHead + SNIFFER_RECORD_HEADER) & SNIFFER_RING_MASK;
+  uint8_t count = 0;
+  uint8_t flags = 0;
+  uint8_t level = 0;
+
+  for (;;) {
+    uint8_t now;
+    bool idle = false;
+
+    // the loop is about 10 cycles, well under the 1us shortest low
+    do {
+      now = TCNT2;
+
+      if ((uint8_t)(now - last) > SNIFFER_IDLE_TICKS) {
+        idle = true;
+        break;
+      }
+    } while ((PIND & JOYBUS_PIN) == level);
+
+    if (idle) {
+      break;
+    }
+
+    if (count < space) {
+      gSnifferRing[index] = now - last;
+      index = (index + 1) & SNIFFER_RING_MASK;
+      ++count;
+    } else {
+      flags |= SNIFFER_FLAG_TRUNCATED;
+    }
+
+    last = now;
+    level ^= JOYBUS_PIN;
+  }
+
+  if (level == 0) {
+    // stuck low, not a transaction
+    flags |= SNIFFER_FLAG_TRUNCATED;
+  }
+
+  gSnifferRing[gSnifferHead] = (uint8_t)start;
+  gSnifferRing[(gSnifferHead + 1) & SNIFFER_RING_MASK] = (uint8_t)(start >> 8);
+  gSnifferRing[(gSnifferHead + SNIFFER_RECORD_COUNT) & SNIFFER_RING_MASK] = count;
+  gSnifferRing[(gSnifferHead + SNIFFER_RECORD_FLAGS) & SNIFFER_RING_MASK] = flags;
+
+  gSnifferHead = index;
+}
+
+void snifferPrint_P(const char* text) {
+  char next;
+
+  while ((next = pgm_read_byte(text)) != '\0') {
+    Serial.write(next);
+    ++text;
+  }
+}
+
+void snifferPrintValue(const char* key, uint32_t value) {
+  snifferPrint_P(key);
+  Serial.print(value);
+}
+
+// same fields and order as tools/joybus_decode.c, returns false after
+// the last one
+bool snifferPrintReportField(struct JoybusSessionStats* stats, uint8_t field) {
+  switch (field) {
+    case 0:
+      snifferPrintValue(PSTR("S n="), stats->transactions);
+      break;
+    case 1:
+      snifferPrintValue(PSTR(" period_us="), stats->minPeriodUs);
+      snifferPrintValue(PSTR("/"), joybusStatsAveragePeriodUs(stats));
+      snifferPrintValue(PSTR("/"), stats->maxPeriodUs);
+      break;
+    case 2:
+      snifferPrintValue(PSTR(" jitter_us="), joybusStatsJitterUs(stats));
+      break;
+    case 3:
+      snifferPrintValue(PSTR(" idle_min_us="), stats->minIdleUs);
+      break;
+    case 4:
+      snifferPrintValue(PSTR(" busy_max_us="), stats->maxBusyUs);
+      snifferPrintValue(PSTR(" busy_pct="), joybusStatsBusyPercent(stats));
+      break;
+    case 5:
+      snifferPrintValue(PSTR(" cmd_00="), stats->commands[JoybusCommandStatus]);
+      snifferPrintValue(PSTR(" cmd_01="), stats->commands[JoybusCommandPoll]);
+      break;
+    case 6:
+      snifferPrintValue(PSTR(" cmd_02="), stats->commands[JoybusCommandRead]);
+      snifferPrintValue(PSTR(" cmd_03="), stats->commands[JoybusCommandWrite]);
+      break;
+    case 7:
+      snifferPrintValue(PSTR(" cmd_ff="), stats->commands[JoybusCommandReset]);
+      snifferPrintValue(PSTR(" cmd_other="), stats->commands[JoybusCommandOther]);
+      break;
+    case 8:
+      snifferPrintValue(PSTR(" no_resp="), stats->noResponse);
+      snifferPrintValue(PSTR(" bad_resp="), stats->badResponse);
+      break;
+    case 9:
+      snifferPrintValue(PSTR(" truncated="), stats->truncated);
+      snifferPrintValue(PSTR(" missed="), stats->missed);
+      Serial.write('\n');
+      break;
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+// longest report field, so printing one never waits on the uart
+#define SNIFFER_REPORT_FIELD_MAX    40
+
+void snifferQueueReport() {
+  memcpy(&gSnifferReport, &gSnifferStats, sizeof(gSnifferReport));
+  gSnifferReportPending = true;
+  gSnifferReportField = 0;
+
+  joybusStatsReset(&gSnifferStats);
+}
+
+char snifferHexDigit(uint8_t value) {
+  value &= 0xF;
+  return value < 10 ? '0' + value : 'A' + value - 10;
+}
+
+// "E ssss dddd..\n" with the start in 4us ticks and each edge as 2 hex
+// digits, T instead of E for a truncated capture
+char snifferRawChar(uint16_t record, uint8_t count, uint8_t flags, uint16_t pos) {
+  if (pos == 0) {
+    return (flags & SNIFFER_FLAG_TRUNCATED) ? 'T' : 'E';
+  }
+
+  if (pos == 1 || pos == 6) {
+    return ' ';
+  }
+
+  if (pos < 6) {
+    uint16_t start = snifferRingRead(record) | ((uint16_t)snifferRingRead(record + 1) << 8);
+    return snifferHexDigit(start >> ((5 - pos) * 4));
+  }
+
+  pos -= 7;
+
+  if (pos < (uint16_t)count * 2) {
+    uint8_t edge = snifferRingRead(record + SNIFFER_RECORD_HEADER + (pos >> 1));
+    return snifferHexDigit((pos & 1) ? edge : edge >> 4);
+  }
+
+  return '\n';
+}
+
+void snifferDecodeRecord(uint16_t record) {
+  uint8_t count = snifferRingRead(record + SNIFFER_RECORD_COUNT);
+  uint8_t flags = snifferRingRead(record + SNIFFER_RECORD_FLAGS);
+  uint16_t start = snifferRingRead(record) | ((uint16_t)snifferRingRead(record + 1) << 8);
+
+  struct JoybusTransaction transaction;
+  struct JoybusDecoder decoder;
+
+  joybusDecoderInit(&decoder, &transaction);
+
+  for (uint8_t i = 0; i < count; ++i) {
+    joybusDecoderEdge(&decoder, snifferRingRead(record + SNIFFER_RECORD_HEADER + i));
+  }
+
+  joybusDecoderFinish(&decoder);
+
+  joybusStatsAdd(&gSnifferStats, start, &transaction, flags & SNIFFER_FLAG_TRUNCATED);
+
+  if (gSnifferStats.transactions >= JOYBUS_STATS_MAX_TRANSACTIONS && !gSnifferReportPending) {
+    snifferQueueReport();
+  }
+}
+
+// does one piece of background work, returns false if there was nothing to do
+bool snifferWorkStep() {
+  if (gSnifferTail != gSnifferHead) {
+    uint16_t record = gSnifferTail;
+    uint8_t count = snifferRingRead(record + SNIFFER_RECORD_COUNT);
+
+    if (!gSnifferTailDecoded) {
+      snifferDecodeRecord(record);
+      gSnifferTailDecoded = true;
+      gSnifferEmitPos = 0;
+      return true;
+    }
+
+#if SNIFFER_RAW_OUTPUT
+    uint16_t lineLength = 8 + (uint16_t)count * 2;
+    uint8_t flags = snifferRingRead(record + SNIFFER_RECORD_FLAGS);
+    int room = Serial.availableForWrite();
+
+    while (room > 0 && gSnifferEmitPos < lineLength) {
+      Serial.write(snifferRawChar(record, count, flags, gSnifferEmitPos));
+      ++gSnifferEmitPos;
+      --room;
+    }
+
+    if (gSnifferEmitPos < lineLength) {
+      return true;
+    }
+#endif
+
+    gSnifferTail = (record + SNIFFER_RECORD_HEADER + count) & SNIFFER_RING_MASK;
+    gSnifferTailDecoded = false;
+
+    return true;
+  }
+
+  if (gSnifferReportPending) {
+    if (Serial.availableForWrite() >= SNIFFER_REPORT_FIELD_MAX) {
+      if (!snifferPrintReportField(&gSnifferReport, gSnifferReportField)) {
+        gSnifferReportPending = false;
+      }
+
+      ++gSnifferReportField;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+// no work once the next transaction could be close
+bool snifferWorkAllowed() {
+  if (!gSnifferSessionActive) {
+    return true;
+  }
+
+  uint16_t window = SNIFFER_MIN_WORK_WINDOW;
+
+  if (gSnifferStats.periodCount) {
+    uint32_t minPeriod = gSnifferStats.minPeriodUs / 4;
+
+    if (minPeriod > TIME_MAX_WAIT) {
+      minPeriod = TIME_MAX_WAIT;
+    }
+
+    if (minPeriod > (uint32_t)SNIFFER_WORK_GUARD + window) {
+      window = (uint16_t)minPeriod - SNIFFER_WORK_GUARD;
+    }
+  }
+
+  return timeElapsed(gSnifferLastStart) < window;
+}
+
+void snifferEndSession() {
+  // the line is quiet so everything left can be sent, waiting on the uart
+  while (snifferWorkStep());
+
+  if (gSnifferStats.transactions) {
+    snifferQueueReport();
+
+    while (snifferWorkStep());
+  }
+
+  gSnifferSessionActive = false;
+}
+
+void snifferCheckSessionEnd() {
+  if (gSnifferSessionActive && timeElapsed(gSnifferLastStart) > SNIFFER_SESSION_GAP) {
+    snifferEndSession();
+  }
+}
+
+// waits for the line to stay high for a whole idle period
+void snifferWaitIdle() {
+  uint8_t last = TCNT2;
+
+  for (;;) {
+    if (!(PIND & JOYBUS_PIN)) {
+      last = TCNT2;
+    } else if ((uint8_t)(TCNT2 - last) > SNIFFER_IDLE_TICKS) {
+      return;
+    }
+
+    snifferCheckSessionEnd();
+  }
+}
+
+void snifferUpdate() {
+  while (snifferWorkAllowed() && snifferWorkStep());
+
+  if ((EIFR & (1 << INTF0)) || !(PIND & JOYBUS_PIN)) {
+    // the line moved while the loop was busy, the start of that
+    // transaction is lost
+    if (gSnifferSessionActive) {
+      ++gSnifferStats.missed;
+      gSnifferLastStart = timeNow();
+    }
+
+    snifferWaitIdle();
+    EIFR = (1 << INTF0);
+    return;
+  }
+
+  if (gSnifferSessionActive) {
+    uint16_t elapsed = timeElapsed(gSnifferLastStart);
+
+    if (elapsed > SNIFFER_SESSION_GAP) {
+      snifferEndSession();
+      return;
+    }
+
+    // the rest of the gap is counted in Timer2 overflows so the loop
+    // never stops to read Timer1, an edge during that would be timed late
+    uint16_t overflows = (SNIFFER_SESSION_GAP - elapsed) / SNIFFER_TIMER2_OVERFLOW + 1;
+
+    TIFR2 = (1 << TOV2);
+
+    while (PIND & JOYBUS_PIN) {
+      if (TIFR2 & (1 << TOV2)) {
+        TIFR2 = (1 << TOV2);
+
+        if (--overflows == 0) {
+          snifferEndSession();
+          return;
+        }
+      }
+    }
+  } else {
+    while (PIND & JOYBUS_PIN);
+  }
+
+  cli();
+  snifferCapture();
+  sei();
+
+  // the capture's own edges set the flag
+  EIFR = (1 << INTF0);
+
+  if (!gSnifferSessionActive) {
+    gSnifferSessionActive = true;
+    joybusStatsReset(&gSnifferStats);
+  }
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __JOYBUS_SNIFFER_H__
+#define __JOYBUS_SNIFFER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "debug_print.h"
+#include "joybus_decoder.h"
+#include "timebase.h"
+
+// build a passive sniffer that listens to the console on pin 2 instead
+// of a USB adapter
+#define JOYBUS_SNIFFER          0
+
+#define SNIFFER_BAUD            500000
+// print every capture as a line tools/joybus_decode.c can read
+#define SNIFFER_RAW_OUTPUT      1
+// edge ring, size must be a power of 2
+#define SNIFFER_RING_SIZE       512
+// a high this long ends a capture, has to fit in Timer2's 8 bits
+#define SNIFFER_IDLE_TICKS      (50 * JOYBUS_TICKS_PER_US)
+// no transactions for this long ends the session
+#define SNIFFER_SESSION_GAP     TIME_MS(200)
+// Timer2 wraps every 256 ticks of 0.5us
+#define SNIFFER_TIMER2_OVERFLOW TIME_US(128)
+// background work stops this long before the next transaction is
+// expected so the uart is quiet when it starts
+#define SNIFFER_WORK_GUARD      TIME_MS(2)
+// used until the session has a period to go by
+#define SNIFFER_MIN_WORK_WINDOW TIME_US(500)
+
+#if JOYBUS_SNIFFER
+
+#if !DEBUG_SERIAL
+#error "the sniffer reports over the serial port, use the parallel transport without telemetry"
+#endif
+
+void snifferInit();
+void snifferUpdate();
+
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+#include "messages.h"
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+#include "debug_print.h"
+#include "telemetry.h"
+
+#define MESSAGE_STRING(id, text) const char gText##id[] PROGMEM = text;
+#define MESSAGE_TABLE_ENTRY(id, text) gText##id,
+
+MESSAGE_LIST(MESSAGE_STRING)
+
+const char* const gMessages[MessageCount] PROGMEM = {
+  MESSAGE_LIST(MESSAGE_TABLE_ENTRY)
+};
+
+void printMessage(uint8_t id) {
+#if DEBUG_SERIAL
+  if (id >= MessageCount) {
+    return;
+  }
+
+  const char* text = (const char*)pgm_read_ptr(&gMessages[id]);
+  char next;
+
+  while ((next = pgm_read_byte(text)) != '\0') {
+    Serial.write(next);
+    ++text;
+  }
+#elif TELEMETRY
+  telemetrySendLog(id, NULL, 0);
+#endif
+}
+
+void printMessageHex(uint8_t id, uint8_t value) {
+#if DEBUG_SERIAL
+  printMessage(id);
+  printHex(value);
+  Serial.write('\n');
+#elif TELEMETRY
+  telemetrySendLog(id, &value, 1);
+#endif
+}
+
+void printMessageWord(uint8_t id, uint16_t value) {
+#if DEBUG_SERIAL
+  printMessage(id);
+  printHex(value >> 8);
+  printHex(value & 0xFF);
+  Serial.write('\n');
+#elif TELEMETRY
+  uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+  telemetrySendLog(id, bytes, sizeof(bytes));
+#endif
+}
@@ -0,0 +1,49 @@
+#ifndef __MESSAGES_H__
+#define __MESSAGES_H__
+
+#include <stdint.h>
+
+// every diagnostic string, kept in flash and printed by id
+#define MESSAGE_LIST(X) \
+  X(MessageIcVersion,             "GET_IC_VER: 0x") \
+  X(MessageStatus,                "GET_STATUS: 0x") \
+  X(MessageUSBModeActive,         "setUSBMode(USBModeActive): 0x") \
+  X(MessageUSBModeFailed,         "Failed to setup USB mode\n") \
+  X(MessageAddressZero,           "Setting target address to 0\n") \
+  X(MessageDeviceId,              "Device id 0x") \
+  X(MessageQuirkFlags,            "Using device quirks: 0x") \
+  X(MessageUnsupportedClass,      "Unsupported device class 0x") \
+  X(MessageSettingAddress,        "Configuring target to have address 0x") \
+  X(MessageAddressFailed,         "Failed to configure device address\n") \
+  X(MessageAddressConfigured,     "Configured device address\n") \
+  X(MessageGettingDevice,         "Getting boot mouse\n") \
+  X(MessageNoDevice,              "Could not find boot mouse\n") \
+  X(MessageFoundDevice,           "Found boot mouse at ") \
+  X(MessageSeparator,             ", ") \
+  X(MessageNewline,               "\n") \
+  X(MessageSetConfigFailed,       "Could not set configuration\n") \
+  X(MessageReportDescFailed,      "Could not read report descriptor\n") \
+  X(MessageUnsupportedGamepad,    "Unsupported gamepad\n") \
+  X(MessageSetProtocolFailed,     "Could not set protocol\n") \
+  X(MessageResettingDevice,       "Resetting device after failed polls\n") \
+  X(MessageOverflow,              "Overflow!\n") \
+  X(MessageInputFailed,           "Failed to get input data\n") \
+  X(MessageOutputFailed,          "Failed to send output data\n") \
+  X(MessageRumbleFailed,          "Failed to send rumble report\n") \
+  X(MessageStackFree,             "Stack free: 0x") \
+
+#define MESSAGE_ENUM_ENTRY(id, text) id,
+
+enum MessageId {
+  MESSAGE_LIST(MESSAGE_ENUM_ENTRY)
+
+  MessageCount,
+};
+
+void printMessage(uint8_t id);
+// prints the message followed by a hex value and a newline
+void printMessageHex(uint8_t id, uint8_t value);
+// same with a 16 bit value
+void printMessageWord(uint8_t id, uint16_t value);
+
+#endif
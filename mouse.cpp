@@ -0,0 +1,38 @@
+#include "mouse.h"
+
+#include <Arduino.h>
+
+#include "runtime_params.h"
+
+#define MOUSE_BUTTON_LEFT   0x01
+#define MOUSE_BUTTON_RIGHT  0x02
+
+int8_t mouseScaleMotion(int32_t motion, uint8_t sensitivity) {
+  int32_t scaled = (motion * sensitivity) / PARAM_SENSITIVITY_ONE;
+
+  if (scaled > 127) {
+    return 127;
+  } else if (scaled < -128) {
+    return -128;
+  }
+
+  return (int8_t)scaled;
+}
+
+void mouseTranslate(struct ReportValues* values, uint8_t sensitivity, struct N64ControllerState* state) {
+  uint8_t pressed = (uint8_t)values->fields[ReportFieldButtons];
+  uint16_t buttons = 0;
+
+  if (pressed & MOUSE_BUTTON_LEFT) {
+    buttons |= N64_BUTTON_A;
+  }
+
+  if (pressed & MOUSE_BUTTON_RIGHT) {
+    buttons |= N64_BUTTON_B;
+  }
+
+  state->buttons = buttons;
+  state->stickX = mouseScaleMotion(values->fields[ReportFieldX], sensitivity);
+  // hid y points down
+  state->stickY = mouseScaleMotion(-values->fields[ReportFieldY], sensitivity);
+}
@@ -0,0 +1,13 @@
+#ifndef __MOUSE_H__
+#define __MOUSE_H__
+
+#include <stdint.h>
+
+#include "report_layout.h"
+#include "n64_controller.h"
+
+// the N64 mouse sends the motion since the last poll in the stick bytes
+// and its two buttons as A and B, sensitivity is in 1/16ths
+void mouseTranslate(struct ReportValues* values, uint8_t sensitivity, struct N64ControllerState* state);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __N64_CONTROLLER_H__
+#define __N64_CONTROLLER_H__
+
+#include <stdint.h>
+
+// button bits in the order the controller sends them
+#define N64_BUTTON_A        0x8000
+#define N64_BUTTON_B        0x4000
+#define N64_BUTTON_Z        0x2000
+#define N64_BUTTON_START    0x1000
+#define N64_BUTTON_D_UP     0x0800
+#define N64_BUTTON_D_DOWN   0x0400
+#define N64_BUTTON_D_LEFT   0x0200
+#define N64_BUTTON_D_RIGHT  0x0100
+#define N64_BUTTON_L        0x0020
+#define N64_BUTTON_R        0x0010
+#define N64_BUTTON_C_UP     0x0008
+#define N64_BUTTON_C_DOWN   0x0004
+#define N64_BUTTON_C_LEFT   0x0002
+#define N64_BUTTON_C_RIGHT  0x0001
+
+// an original stick reaches about +-80 at the edge of the gate
+#define N64_STICK_RANGE     80
+
+struct N64ControllerState {
+  uint16_t buttons;
+  int8_t stickX;
+  int8_t stickY;
+};
+
+#endif
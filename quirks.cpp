@@ -0,0 +1,42 @@
+#include "quirks.h"
+
+#include <string.h>
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+// devices that need something other than the generic enumeration, the
+// list ends with an entry with an idVendor of 0
+//
+// { idVendor, idProduct, { flags, protocol, settleMs, retries, endpoint, rumbleOffset, rumbleOn } }
+// for example a mouse that stalls SET_PROTOCOL and needs time after
+// being addressed would be
+// { 0x1234, 0x5678, { QUIRK_SKIP_SET_PROTOCOL, 0, 50, 2, 0, 0, 0 } },
+// and a pad with its motor strength in byte 3 of the output report
+// { 0x1234, 0x5679, { QUIRK_RUMBLE_OUTPUT, 0, 0, 0, 0, 3, 0xFF } },
+const struct DeviceQuirkEntry gDeviceQuirks[] PROGMEM = {
+  { 0x0000, 0x0000, { 0, 0, 0, 0, 0, 0, 0 } },
+};
+
+bool quirkLookup(uint16_t idVendor, uint16_t idProduct, struct DeviceQuirk* result) {
+  const struct DeviceQuirkEntry* entry = gDeviceQuirks;
+
+  for (;;) {
+    uint16_t entryVendor = pgm_read_word(&entry->idVendor);
+
+    if (entryVendor == 0) {
+      break;
+    }
+
+    if (entryVendor == idVendor && pgm_read_word(&entry->idProduct) == idProduct) {
+      memcpy_P(result, &entry->quirk, sizeof(struct DeviceQuirk));
+      return true;
+    }
+
+    ++entry;
+  }
+
+  memset(result, 0, sizeof(struct DeviceQuirk));
+
+  return false;
+}
@@ -0,0 +1,51 @@
+#ifndef __QUIRKS_H__
+#define __QUIRKS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// don't send SET_PROTOCOL at all
+#define QUIRK_SKIP_SET_PROTOCOL     0x01
+// don't read the report descriptor, mice fall back to the boot layout
+#define QUIRK_SKIP_REPORT_DESC      0x02
+// accept the device even if bDeviceClass isn't 0 or HID
+#define QUIRK_IGNORE_DEVICE_CLASS   0x04
+// send SET_PROTOCOL with quirk.protocol instead of the default
+#define QUIRK_FORCE_PROTOCOL        0x08
+// poll quirk.endpoint instead of the one found in the config descriptor
+#define QUIRK_FORCE_ENDPOINT        0x10
+// the output report drives the motors, quirk.rumbleOffset says where
+#define QUIRK_RUMBLE_OUTPUT         0x20
+// keep retrying timeouts while polling, NAKs still return right away
+#define QUIRK_POLL_RETRY            0x40
+
+// wait between attempts of an enumeration step
+#define QUIRK_RETRY_DELAY_MS        10
+
+struct DeviceQuirk {
+  uint8_t flags;
+  // SET_PROTOCOL value used with QUIRK_FORCE_PROTOCOL
+  uint8_t protocol;
+  // extra wait after SET_ADDRESS before the device is talked to again
+  uint8_t settleMs;
+  // extra attempts for each enumeration step
+  uint8_t retries;
+  // endpoint address used with QUIRK_FORCE_ENDPOINT
+  uint8_t endpoint;
+  // byte of the output report that turns the motors on with
+  // QUIRK_RUMBLE_OUTPUT, counting the report id, the rest are sent as 0
+  uint8_t rumbleOffset;
+  uint8_t rumbleOn;
+};
+
+struct DeviceQuirkEntry {
+  uint16_t idVendor;
+  uint16_t idProduct;
+  struct DeviceQuirk quirk;
+};
+
+// fills in the quirk for the device, unknown devices get an empty quirk
+// and take the generic path, returns true if the device was found
+bool quirkLookup(uint16_t idVendor, uint16_t idProduct, struct DeviceQuirk* result);
+
+#endif
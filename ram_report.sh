@@ -0,0 +1,33 @@
+#!/bin/bash
+# static ram use per source file, run by "make -C sim firmware" after each
+# build or by hand with the path to any other build of the sketch
+#   ./ram_report.sh [path/to/USBTesting.ino.elf]
+ELF=${1:-$(dirname "$0")/build/USBTesting.ino.elf}
+
+if [ ! -f "$ELF" ]; then
+  echo "no firmware at $ELF, build it with make -C sim firmware" >&2
+  exit 1
+fi
+
+avr-size -C --mcu=atmega328p "$ELF"
+
+# .data and .bss symbols with the file they were defined in
+avr-nm -S -l -t d "$ELF" | awk '
+  $3 ~ /^[bBdD]$/ {
+    file = "(no line info)"
+    if (NF >= 5) {
+      file = $5
+      sub(/:[0-9]+$/, "", file)
+      n = split(file, parts, "/")
+      file = parts[n]
+    }
+    ram[file] += $2
+    total += $2
+  }
+  END {
+    for (file in ram) {
+      printf "%6d %s\n", ram[file], file
+    }
+    printf "%6d total\n", total
+  }
+' | sort -n
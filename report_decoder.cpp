@@ -0,0 +1,116 @@
+#include "report_decoder.h"
+
+#include <string.h>
+
+#include <Arduino.h>
+
+#include "usb_transfer.h"
+
+void reportDecoderAddOp(struct ReportDecoder* decoder, uint8_t reportByte, uint8_t target) {
+    // insertion sort, there are only a handful of ops
+    uint8_t index = decoder->opCount;
+
+    while (index > 0 && decoder->ops[index - 1].reportByte > reportByte) {
+        decoder->ops[index] = decoder->ops[index - 1];
+        --index;
+    }
+
+    decoder->ops[index].reportByte = reportByte;
+    decoder->ops[index].target = target;
+    ++decoder->opCount;
+}
+
+void reportDecoderInit(struct HidInfo* info) {
+    struct ReportLayout* layout = &info->layout;
+    struct ReportDecoder* decoder = &info->decoder;
+
+    // the report id comes before the fields
+    uint8_t firstByte = layout->reportId ? 1 : 0;
+
+    decoder->opCount = 0;
+    decoder->minLength = firstByte;
+
+    for (uint8_t fieldIndex = 0; fieldIndex < ReportFieldCount; ++fieldIndex) {
+        struct ReportField* field = &layout->fields[fieldIndex];
+
+        if (field->bitSize == 0) {
+            continue;
+        }
+
+        uint8_t start = firstByte + (field->bitOffset >> 3);
+        uint8_t byteCount = ((field->bitOffset & 0x7) + field->bitSize + 7) >> 3;
+
+        for (uint8_t i = 0; i < byteCount; ++i) {
+            reportDecoderAddOp(decoder, start + i, fieldIndex * sizeof(int32_t) + i);
+        }
+
+        if (start + byteCount > decoder->minLength) {
+            decoder->minLength = start + byteCount;
+        }
+    }
+}
+
+bool reportDecoderRead(struct HidInfo* info, struct ReportValues* values, uint8_t* length) {
+    struct ReportDecoder* decoder = &info->decoder;
+    struct ReportLayout* layout = &info->layout;
+
+    memset(values, 0, sizeof(struct ReportValues));
+
+    usbWriteByte(RD_USB_DATA, false);
+    uint8_t reportLength = usbReadByte();
+    *length = reportLength;
+
+    if (reportLength > USB_MAX_PACKET_SIZE) {
+        // not a length the chip can hold, like the 0xFF a timed out uart
+        // read gives. Nothing is read, the buffer is released and the
+        // next command ends RD_USB_DATA.
+        usbWriteByte(UNLOCK_USB, false);
+        return false;
+    }
+
+    uint8_t* target = (uint8_t*)values->fields;
+    struct ReportDecodeOp* op = decoder->ops;
+    struct ReportDecodeOp* opEnd = decoder->ops + decoder->opCount;
+    bool valid = reportLength >= decoder->minLength;
+
+    uint8_t index = 0;
+
+    if (layout->reportId && reportLength) {
+        valid = valid && usbReadByte() == layout->reportId;
+        ++index;
+    }
+
+    // the whole report has to come off the bus, only bytes with an op are kept
+    for (; index < reportLength; ++index) {
+        uint8_t next = usbReadByte();
+
+        while (op != opEnd && op->reportByte == index) {
+            target[op->target] = next;
+            ++op;
+        }
+    }
+
+    if (!valid) {
+        return false;
+    }
+
+    for (uint8_t fieldIndex = 0; fieldIndex < ReportFieldCount; ++fieldIndex) {
+        struct ReportField* field = &layout->fields[fieldIndex];
+
+        if (field->bitSize == 0) {
+            continue;
+        }
+
+        uint32_t mask = (1UL << field->bitSize) - 1;
+        uint32_t value = ((uint32_t)values->fields[fieldIndex] >> (field->bitOffset & 0x7)) & mask;
+
+        if (field->logicalMin < 0 && (value & (1UL << (field->bitSize - 1)))) {
+            // sign extend
+            value |= ~mask;
+        }
+
+        values->fields[fieldIndex] = (int32_t)value;
+    }
+
+    return true;
+}
@@ -0,0 +1,18 @@
+#ifndef __REPORT_DECODER_H__
+#define __REPORT_DECODER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "descriptor_parser.h"
+
+// compiles info->layout into info->decoder, call after the layout changes
+void reportDecoderInit(struct HidInfo* info);
+
+// reads a report off the CH375B and decodes it into values as it comes in,
+// bytes past the last field are read and dropped. length is set to the
+// number of bytes the device sent, returns false if the report was too
+// short, longer than the CH375B buffer or had the wrong report id
+bool reportDecoderRead(struct HidInfo* info, struct ReportValues* values, uint8_t* length);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef __REPORT_LAYOUT_H__
+#define __REPORT_LAYOUT_H__
+
+#include <stdint.h>
+
+// input reports are truncated to this size, fields past it are ignored
+#define MAX_INPUT_REPORT_SIZE       16
+// widest input field that can be read
+#define MAX_FIELD_BITS              16
+#define MAX_BUTTON_COUNT            16
+// bytes a field can cover when it doesn't start on a byte boundary
+#define MAX_FIELD_BYTES             3
+#define MAX_DECODE_OPS              (ReportFieldCount * MAX_FIELD_BYTES)
+
+enum ReportFieldIndex {
+    ReportFieldX,
+    ReportFieldY,
+    // right stick, Z or Rx
+    ReportFieldRightX,
+    // right stick, Rz or Ry
+    ReportFieldRightY,
+    ReportFieldHat,
+    // all buttons as one field starting at button 1
+    ReportFieldButtons,
+
+    ReportFieldCount,
+};
+
+struct ReportField {
+    uint16_t bitOffset;
+    // 0 if the device doesn't have the field
+    uint8_t bitSize;
+    int32_t logicalMin;
+    int32_t logicalMax;
+};
+
+struct ReportLayout {
+    // 0 if the device doesn't use report ids
+    uint8_t reportId;
+    // generic desktop usage of the application collection holding the
+    // fields, mouse, joystick or gamepad
+    uint8_t application;
+    struct ReportField fields[ReportFieldCount];
+};
+
+// copies one byte off the bus into the decoded fields
+struct ReportDecodeOp {
+    // index of the byte in the report, counting the report id
+    uint8_t reportByte;
+    // byte offset into ReportValues.fields, avr is little endian so byte k
+    // of a field is at field * 4 + k
+    uint8_t target;
+};
+
+// the layout compiled down to the bytes that have to be kept
+struct ReportDecoder {
+    // sorted by reportByte
+    struct ReportDecodeOp ops[MAX_DECODE_OPS];
+    uint8_t opCount;
+    // shortest report that holds every field, counting the report id
+    uint8_t minLength;
+};
+
+// every field of one input report, fields the device doesn't have are 0
+struct ReportValues {
+    int32_t fields[ReportFieldCount];
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include "report_parser.h"
+
+#include <stddef.h>
+
+#include <Arduino.h>
+
+// marks a long item whose size byte hasn't been read yet
+#define LONG_ITEM_SIZE_PENDING  0xFF
+
+void reportParserInit(struct ReportParser* parser, struct HidInfo* info) {
+    parser->prefix = 0;
+    parser->dataSize = 0;
+    parser->dataOffset = 0;
+    parser->data = 0;
+
+    parser->usagePage = 0;
+    parser->logicalMin = 0;
+    parser->logicalMax = 0;
+    parser->reportSize = 0;
+    parser->reportCount = 0;
+    parser->reportId = 0;
+
+    parser->usageCount = 0;
+    parser->usageMin = 0;
+    parser->usageMax = 0;
+
+    parser->collectionDepth = 0;
+    parser->application = 0;
+
+    parser->inputBits = 0;
+    parser->hasInputFields = false;
+
+    parser->outputReportId = 0;
+    parser->outputReportBits = 0;
+
+    parser->info = info;
+    parser->layout = &info->layout;
+
+    reportLayoutClear(parser->layout);
+}
+
+int32_t reportParserSignedData(struct ReportParser* parser) {
+    switch (parser->dataSize) {
+        case 1:
+            return (int8_t)parser->data;
+        case 2:
+            return (int16_t)parser->data;
+        default:
+            return (int32_t)parser->data;
+    }
+}
+
+uint8_t reportParserFieldForUsage(uint16_t usage) {
+    switch (usage) {
+        case HID_USAGE_X:
+            return ReportFieldX;
+        case HID_USAGE_Y:
+            return ReportFieldY;
+        case HID_USAGE_Z:
+        case HID_USAGE_RX:
+            return ReportFieldRightX;
+        case HID_USAGE_RZ:
+        case HID_USAGE_RY:
+            return ReportFieldRightY;
+        case HID_USAGE_HAT_SWITCH:
+            return ReportFieldHat;
+    }
+
+    return ReportFieldCount;
+}
+
+void reportParserSetField(struct ReportParser* parser, uint8_t fieldIndex, uint16_t bitOffset, uint8_t bitSize) {
+    struct ReportLayout* layout = parser->layout;
+    struct ReportField* field = &layout->fields[fieldIndex];
+
+    // first usage found wins
+    if (field->bitSize != 0) {
+        return;
+    }
+
+    if (bitSize == 0 || bitSize > MAX_FIELD_BITS || bitOffset + bitSize > MAX_INPUT_REPORT_SIZE * 8) {
+        return;
+    }
+
+    // only devices that say they are a mouse, joystick or gamepad are mapped
+    if (parser->application != HID_USAGE_MOUSE &&
+        parser->application != HID_USAGE_JOYSTICK &&
+        parser->application != HID_USAGE_GAMEPAD) {
+        return;
+    }
+
+    // all fields have to come from the same report and collection
+    if (parser->hasInputFields && (layout->reportId != parser->reportId || layout->application != parser->application)) {
+        return;
+    }
+
+    layout->reportId = parser->reportId;
+    layout->application = parser->application;
+    parser->hasInputFields = true;
+
+    field->bitOffset = bitOffset;
+    field->bitSize = bitSize;
+    field->logicalMin = parser->logicalMin;
+    field->logicalMax = parser->logicalMax;
+
+    if (field->logicalMin >= 0 && field->logicalMax < field->logicalMin) {
+        // a common descriptor bug, an unsigned maximum like 0xFF written
+        // without the extra byte that keeps it positive
+        field->logicalMax &= (1UL << bitSize) - 1;
+    }
+}
+
+void reportParserInputItem(struct ReportParser* parser, uint8_t flags) {
+    uint16_t itemBits = (uint16_t)parser->reportSize * parser->reportCount;
+
+    if ((flags & HID_MAIN_CONSTANT) || !(flags & HID_MAIN_VARIABLE)) {
+        // padding and array items aren't mapped
+        parser->inputBits += itemBits;
+        return;
+    }
+
+    if (parser->usagePage == HID_USAGE_PAGE_BUTTON) {
+        if (parser->reportSize == 1 && (parser->usageCount ? parser->usages[0] : parser->usageMin) <= 1) {
+            uint8_t buttonCount = parser->reportCount;
+
+            if (buttonCount > MAX_BUTTON_COUNT) {
+                buttonCount = MAX_BUTTON_COUNT;
+            }
+
+            reportParserSetField(parser, ReportFieldButtons, parser->inputBits, buttonCount);
+        }
+    } else if (parser->usagePage == HID_USAGE_PAGE_GENERIC_DESKTOP) {
+        for (uint8_t i = 0; i < parser->reportCount; ++i) {
+            uint16_t usage;
+
+            if (parser->usageCount) {
+                // the last usage repeats for any remaining fields
+                usage = parser->usages[i < parser->usageCount ? i : parser->usageCount - 1];
+            } else {
+                usage = parser->usageMin + i;
+
+                if (usage > parser->usageMax) {
+                    break;
+                }
+            }
+
+            uint8_t fieldIndex = reportParserFieldForUsage(usage);
+
+            if (fieldIndex != ReportFieldCount) {
+                reportParserSetField(parser, fieldIndex, parser->inputBits + (uint16_t)i * parser->reportSize, parser->reportSize);
+            }
+        }
+    }
+
+    parser->inputBits += itemBits;
+}
+
+void reportParserCollection(struct ReportParser* parser) {
+    if (parser->collectionDepth == 0 && (uint8_t)parser->data == HID_COLLECTION_APPLICATION) {
+        uint16_t usage = parser->usageCount ? parser->usages[0] : parser->usageMin;
+
+        if (parser->usagePage == HID_USAGE_PAGE_GENERIC_DESKTOP && usage <= 0xFF) {
+            parser->application = (uint8_t)usage;
+        } else {
+            parser->application = 0;
+        }
+    }
+
+    ++parser->collectionDepth;
+}
+
+void reportParserEndCollection(struct ReportParser* parser) {
+    if (parser->collectionDepth == 0) {
+        return;
+    }
+
+    --parser->collectionDepth;
+
+    if (parser->collectionDepth == 0) {
+        parser->application = 0;
+    }
+}
+
+void reportParserMainItem(struct ReportParser* parser, uint8_t tag) {
+    if (tag == HID_ITEM_COLLECTION) {
+        reportParserCollection(parser);
+    } else if (tag == HID_ITEM_END_COLLECTION) {
+        reportParserEndCollection(parser);
+    } else if (tag == HID_ITEM_INPUT) {
+        reportParserInputItem(parser, (uint8_t)parser->data);
+    } else if (tag == HID_ITEM_OUTPUT) {
+        // only the first output report is used, any others are ignored
+        if (parser->outputReportBits == 0 || parser->outputReportId == parser->reportId) {
+            parser->outputReportId = parser->reportId;
+            parser->outputReportBits += (uint16_t)parser->reportSize * parser->reportCount;
+        }
+    }
+
+    // local items only apply to the next main item
+    parser->usageCount = 0;
+    parser->usageMin = 0;
+    parser->usageMax = 0;
+}
+
+void reportParserItem(struct ReportParser* parser) {
+    uint8_t tag = parser->prefix & HID_ITEM_TAG_MASK;
+    uint8_t value = (uint8_t)parser->data;
+
+    switch (tag) {
+        case HID_ITEM_USAGE_PAGE:
+            parser->usagePage = (uint16_t)parser->data;
+            break;
+        case HID_ITEM_LOGICAL_MIN:
+            parser->logicalMin = reportParserSignedData(parser);
+            break;
+        case HID_ITEM_LOGICAL_MAX:
+            parser->logicalMax = reportParserSignedData(parser);
+            break;
+        case HID_ITEM_REPORT_SIZE:
+            parser->reportSize = value;
+            break;
+        case HID_ITEM_REPORT_COUNT:
+            parser->reportCount = value;
+            break;
+        case HID_ITEM_REPORT_ID:
+            if (parser->reportId != value) {
+                // offsets restart with each report, reports split across
+                // multiple report id items aren't supported
+                parser->inputBits = 0;
+            }
+            parser->reportId = value;
+            break;
+        case HID_ITEM_USAGE:
+            if (parser->usageCount < REPORT_PARSER_MAX_USAGES) {
+                parser->usages[parser->usageCount] = (uint16_t)parser->data;
+                ++parser->usageCount;
+            }
+            break;
+        case HID_ITEM_USAGE_MIN:
+            parser->usageMin = (uint16_t)parser->data;
+            break;
+        case HID_ITEM_USAGE_MAX:
+            parser->usageMax = (uint16_t)parser->data;
+            break;
+        case HID_ITEM_INPUT:
+        case HID_ITEM_OUTPUT:
+        case HID_ITEM_FEATURE:
+        case HID_ITEM_COLLECTION:
+        case HID_ITEM_END_COLLECTION:
+            reportParserMainItem(parser, tag);
+            break;
+    }
+}
+
+void reportParserStep(struct ReportParser* parser, uint8_t next) {
+    if (parser->prefix == 0) {
+        parser->prefix = next;
+        parser->dataOffset = 0;
+        parser->data = 0;
+
+        if (next == HID_ITEM_LONG) {
+            parser->dataSize = LONG_ITEM_SIZE_PENDING;
+            return;
+        }
+
+        parser->dataSize = next & HID_ITEM_SIZE_MASK;
+
+        // a size of 3 means 4 bytes
+        if (parser->dataSize == 3) {
+            parser->dataSize = 4;
+        }
+    } else if (parser->dataSize == LONG_ITEM_SIZE_PENDING) {
+        // long items are skipped, count the tag byte as part of the data
+        parser->dataSize = next + 1;
+        return;
+    } else {
+        if (parser->dataOffset < sizeof(parser->data)) {
+            parser->data |= (uint32_t)next << (parser->dataOffset * 8);
+        }
+        parser->dataOffset++;
+    }
+
+    if (parser->dataOffset == parser->dataSize) {
+        if (parser->prefix != HID_ITEM_LONG) {
+            reportParserItem(parser);
+        }
+        parser->prefix = 0;
+    }
+}
+
+void reportParserPacketHandler(void* data, char* packetData, uint8_t packetSize, uint8_t offset) {
+    struct ReportParser* parser = (struct ReportParser*)data;
+    for (size_t i = 0; i < packetSize; ++i) {
+        reportParserStep(parser, (uint8_t)packetData[i]);
+    }
+}
+
+void reportParserFinish(struct ReportParser* parser) {
+    struct HidInfo* info = parser->info;
+
+    uint8_t outputBytes = (uint8_t)((parser->outputReportBits + 7) >> 3);
+
+    if (parser->outputReportId) {
+        // report id is sent as the first byte
+        ++outputBytes;
+    }
+
+    // anything else could be keyboard leds, device settings or a force
+    // feedback effect, only reports a quirk describes are written
+    bool isRumble = (info->quirk.flags & QUIRK_RUMBLE_OUTPUT) && info->quirk.rumbleOffset < outputBytes;
+
+    if (parser->outputReportBits == 0 || !isRumble || outputBytes > MAX_OUTPUT_REPORT_SIZE) {
+        info->outputReportId = 0;
+        info->outputReportLength = 0;
+        return;
+    }
+
+    info->outputReportId = parser->outputReportId;
+    info->outputReportLength = outputBytes;
+}
+
+bool getHIDReportInfo(struct HidInfo* info) {
+    struct ReportParser parser;
+    reportParserInit(&parser, info);
+
+    info->outputReportId = 0;
+    info->outputReportLength = 0;
+
+    if (info->reportDescriptorLength == 0) {
+        return true;
+    }
+
+    if (!readControlTransfer(
+        0,
+        REQUEST_TYPE_STANDARD | REQUEST_RECIPIENT_INTERFACE,
+        GET_DESCRIPTOR,
+        PACK_WORD_BYTES(DESC_TYPE_REPORT, 0x00),
+        info->bootMouseInterface,
+        info->reportDescriptorLength,
+        &parser,
+        reportParserPacketHandler
+    )) {
+        return false;
+    }
+
+    reportParserFinish(&parser);
+
+    return true;
+}
+
+void reportLayoutClear(struct ReportLayout* layout) {
+    layout->reportId = 0;
+    layout->application = 0;
+
+    for (uint8_t i = 0; i < ReportFieldCount; ++i) {
+        layout->fields[i].bitSize = 0;
+    }
+}
+
+void reportLayoutSetField(struct ReportLayout* layout, uint8_t fieldIndex, uint16_t bitOffset, uint8_t bitSize, int32_t logicalMin, int32_t logicalMax) {
+    struct ReportField* field = &layout->fields[fieldIndex];
+    field->bitOffset = bitOffset;
+    field->bitSize = bitSize;
+    field->logicalMin = logicalMin;
+    field->logicalMax = logicalMax;
+}
+
+void reportLayoutBootMouse(struct ReportLayout* layout) {
+    reportLayoutClear(layout);
+    layout->application = HID_USAGE_MOUSE;
+
+    // buttons, x and y, anything after is vendor specific
+    reportLayoutSetField(layout, ReportFieldButtons, 0, 8, 0, 1);
+    reportLayoutSetField(layout, ReportFieldX, 8, 8, -127, 127);
+    reportLayoutSetField(layout, ReportFieldY, 16, 8, -127, 127);
+}
+
+bool reportLayoutHasField(struct ReportLayout* layout, uint8_t field) {
+    return layout->fields[field].bitSize != 0;
+}
@@ -0,0 +1,111 @@
+#ifndef __REPORT_PARSER_H__
+#define __REPORT_PARSER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "descriptor_parser.h"
+
+// short item prefix is tag(4) type(2) size(2)
+#define HID_ITEM_SIZE_MASK          0x03
+#define HID_ITEM_TAG_MASK           0xFC
+
+// main items
+#define HID_ITEM_INPUT              0x80
+#define HID_ITEM_OUTPUT             0x90
+#define HID_ITEM_COLLECTION         0xA0
+#define HID_ITEM_FEATURE            0xB0
+#define HID_ITEM_END_COLLECTION     0xC0
+
+// global items
+#define HID_ITEM_USAGE_PAGE         0x04
+#define HID_ITEM_LOGICAL_MIN        0x14
+#define HID_ITEM_LOGICAL_MAX        0x24
+#define HID_ITEM_REPORT_SIZE        0x74
+#define HID_ITEM_REPORT_ID          0x84
+#define HID_ITEM_REPORT_COUNT       0x94
+
+// local items
+#define HID_ITEM_USAGE              0x08
+#define HID_ITEM_USAGE_MIN          0x18
+#define HID_ITEM_USAGE_MAX          0x28
+
+#define HID_ITEM_LONG               0xFE
+
+// main item data bits
+#define HID_MAIN_CONSTANT           0x01
+#define HID_MAIN_VARIABLE           0x02
+
+// collection item data
+#define HID_COLLECTION_APPLICATION  0x01
+
+#define HID_USAGE_PAGE_GENERIC_DESKTOP  0x01
+#define HID_USAGE_PAGE_BUTTON           0x09
+
+#define HID_USAGE_MOUSE             0x02
+#define HID_USAGE_JOYSTICK          0x04
+#define HID_USAGE_GAMEPAD           0x05
+
+#define HID_USAGE_X                 0x30
+#define HID_USAGE_Y                 0x31
+#define HID_USAGE_Z                 0x32
+#define HID_USAGE_RX                0x33
+#define HID_USAGE_RY                0x34
+#define HID_USAGE_RZ                0x35
+#define HID_USAGE_HAT_SWITCH        0x39
+
+#define HID_REPORT_TYPE_INPUT       0x01
+#define HID_REPORT_TYPE_OUTPUT      0x02
+#define HID_REPORT_TYPE_FEATURE     0x03
+
+// largest output report the firmware will build
+#define MAX_OUTPUT_REPORT_SIZE      8
+
+#define REPORT_PARSER_MAX_USAGES    4
+
+struct ReportParser {
+    uint8_t prefix;
+    uint8_t dataSize;
+    uint8_t dataOffset;
+    uint32_t data;
+
+    uint16_t usagePage;
+    int32_t logicalMin;
+    int32_t logicalMax;
+    uint8_t reportSize;
+    uint8_t reportCount;
+    uint8_t reportId;
+
+    uint16_t usages[REPORT_PARSER_MAX_USAGES];
+    uint8_t usageCount;
+    uint16_t usageMin;
+    uint16_t usageMax;
+
+    uint8_t collectionDepth;
+    // generic desktop usage of the enclosing application collection, 0
+    // outside of one or for any other page
+    uint8_t application;
+
+    // bit offset of the next input field in the current report
+    uint16_t inputBits;
+    bool hasInputFields;
+
+    uint8_t outputReportId;
+    uint16_t outputReportBits;
+
+    struct HidInfo* info;
+    struct ReportLayout* layout;
+};
+
+void reportParserInit(struct ReportParser* parser, struct HidInfo* info);
+void reportParserPacketHandler(void* data, char* packetData, uint8_t packetSize, uint8_t offset);
+void reportParserFinish(struct ReportParser* parser);
+
+bool getHIDReportInfo(struct HidInfo* info);
+
+void reportLayoutClear(struct ReportLayout* layout);
+// the fixed layout of a boot protocol mouse report
+void reportLayoutBootMouse(struct ReportLayout* layout);
+bool reportLayoutHasField(struct ReportLayout* layout, uint8_t field);
+
+#endif
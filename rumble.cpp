@@ -0,0 +1,107 @@
+#include "rumble.h"
+
+#if RUMBLE
+
+#include <Arduino.h>
+
+#include "usb_transfer.h"
+#include "usb_hid.h"
+#include "report_parser.h"
+#include "debug_print.h"
+#include "messages.h"
+
+volatile bool gRumbleRequested = false;
+bool gRumbleSent = false;
+bool gOddRumbleParity = false;
+
+void rumbleSetState(bool enabled) {
+  gRumbleRequested = enabled;
+}
+
+bool rumbleHandleAccessoryWrite(uint16_t address, const uint8_t* data) {
+  // the low 5 bits of the address are a checksum
+  if ((address & RUMBLE_PAK_ADDRESS_MASK) != RUMBLE_PAK_ADDRESS) {
+    return false;
+  }
+
+  // the whole block is filled with the same value
+  rumbleSetState(data[0] != 0);
+  return true;
+}
+
+void rumbleReset() {
+  gRumbleSent = false;
+  gOddRumbleParity = false;
+}
+
+bool rumbleUpdate(struct HidInfo* hidInfo) {
+  if (hidInfo->bootMouseEndpoint == 0 || hidInfo->outputReportLength == 0) {
+    return false;
+  }
+
+  // bursts of toggles between polls collapse into the latest state
+  bool requested = gRumbleRequested;
+
+  if (requested == gRumbleSent) {
+    return false;
+  }
+
+  // connect and disconnect handling takes priority over rumble
+  if (!(PIND & USB_INT)) {
+    return false;
+  }
+
+  char report[MAX_OUTPUT_REPORT_SIZE];
+  uint8_t offset = 0;
+
+  if (hidInfo->outputReportId) {
+    report[0] = hidInfo->outputReportId;
+    offset = 1;
+  }
+
+  for (uint8_t i = offset; i < hidInfo->outputReportLength; ++i) {
+    report[i] = 0;
+  }
+
+  report[hidInfo->quirk.rumbleOffset] = requested ? hidInfo->quirk.rumbleOn : 0;
+
+  bool sent;
+
+  // a NAK comes straight back and the report goes again next period,
+  // waiting on a busy device would hold up polling
+  setRetryMode(USB_RETRY_TIMEOUTS);
+
+  if (hidInfo->outputEndpoint) {
+    sent = writeInterruptTransfer(hidInfo->outputEndpoint & 0x0F, gOddRumbleParity, report, hidInfo->outputReportLength);
+
+    if (sent) {
+      gOddRumbleParity = !gOddRumbleParity;
+    }
+  } else {
+    sent = writeControlTransfer(
+      0, 
+      REQUEST_TYPE_CLASS | REQUEST_RECIPIENT_INTERFACE, 
+      SET_REPORT, 
+      PACK_WORD_BYTES(HID_REPORT_TYPE_OUTPUT, hidInfo->outputReportId), 
+      hidInfo->bootMouseInterface, 
+      hidInfo->outputReportLength, 
+      report
+    );
+  }
+
+  usbSetPollRetry(hidInfo);
+
+  if (!sent) {
+#if DEBUG
+    printMessage(MessageRumbleFailed);
+#endif
+    // try again next poll period
+    return false;
+  }
+
+  gRumbleSent = requested;
+
+  return true;
+}
+
+#endif
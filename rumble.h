@@ -0,0 +1,32 @@
+#ifndef __RUMBLE_H__
+#define __RUMBLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "descriptor_parser.h"
+
+// forward rumble pak writes to the device, leave off until the Joybus
+// responder exists and calls rumbleHandleAccessoryWrite, nothing else
+// can turn the motors on
+#define RUMBLE                      0
+
+// rumble pak motor control lives at 0xC000 in the accessory address space
+#define RUMBLE_PAK_ADDRESS_MASK     0xE000
+#define RUMBLE_PAK_ADDRESS          0xC000
+
+#if RUMBLE
+
+// safe to call from the joybus handler, only records the requested state
+void rumbleSetState(bool enabled);
+// decodes a joybus accessory write, returns true if it was a rumble write
+bool rumbleHandleAccessoryWrite(uint16_t address, const uint8_t* data);
+
+// clears the sent state when a new device is connected
+void rumbleReset();
+// sends at most one output report, call once per poll period after polling
+bool rumbleUpdate(struct HidInfo* hidInfo);
+
+#endif
+
+#endif
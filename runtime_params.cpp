@@ -0,0 +1,56 @@
+#include "runtime_params.h"
+
+#include <Arduino.h>
+
+#include "usb_hid.h"
+
+struct RuntimeParams gRuntimeParams = {
+  false,
+  PARAM_SENSITIVITY_ONE,
+  0,
+};
+
+struct RuntimeParams* runtimeParams() {
+  return &gRuntimeParams;
+}
+
+bool runtimeParamSet(uint8_t param, uint16_t value) {
+  switch (param) {
+    case PARAM_STREAM_REPORTS:
+      if (value > 1) {
+        return false;
+      }
+      gRuntimeParams.streamReports = value != 0;
+      return true;
+    case PARAM_SENSITIVITY:
+      if (value == 0 || value > 0xFF) {
+        return false;
+      }
+      gRuntimeParams.sensitivity = (uint8_t)value;
+      return true;
+    case PARAM_POLL_INTERVAL:
+      if (value > MAX_POLL_INTERVAL_MS) {
+        return false;
+      }
+      gRuntimeParams.pollIntervalMs = (uint8_t)value;
+      return true;
+  }
+
+  return false;
+}
+
+bool runtimeParamGet(uint8_t param, uint16_t* value) {
+  switch (param) {
+    case PARAM_STREAM_REPORTS:
+      *value = gRuntimeParams.streamReports;
+      return true;
+    case PARAM_SENSITIVITY:
+      *value = gRuntimeParams.sensitivity;
+      return true;
+    case PARAM_POLL_INTERVAL:
+      *value = gRuntimeParams.pollIntervalMs;
+      return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,26 @@
+#ifndef __RUNTIME_PARAMS_H__
+#define __RUNTIME_PARAMS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "telemetry_protocol.h"
+
+// 16 is 1:1 mouse motion
+#define PARAM_SENSITIVITY_ONE       16
+
+// settings that can be changed without reflashing, see PARAM_* in
+// telemetry_protocol.h for the ranges
+struct RuntimeParams {
+  bool streamReports;
+  uint8_t sensitivity;
+  // 0 uses the endpoint's bInterval
+  uint8_t pollIntervalMs;
+};
+
+struct RuntimeParams* runtimeParams();
+// returns false if the param doesn't exist or the value is out of range
+bool runtimeParamSet(uint8_t param, uint16_t value);
+bool runtimeParamGet(uint8_t param, uint16_t* value);
+
+#endif
@@ -0,0 +1,435 @@
+#include "ch375_model.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <simavr/avr_ioport.h>
+#include <simavr/sim_time.h>
+#include <simavr/sim_cycle_timers.h>
+
+// command codes and pin masks are shared with the firmware
+#include "../usb_transfer.h"
+
+#define N64_LINE            (1 << 2)
+
+#define IC_VERSION          0xB7
+
+// boot mouse the model enumerates as
+#define MOUSE_REPORT_DESC_LENGTH    50
+
+static const uint8_t gDeviceDescriptor[18] = {
+    18, 0x01, 0x10, 0x01,
+    0x00, 0x00, 0x00, 8,
+    0x6D, 0x04, 0x77, 0xC0,
+    0x00, 0x01, 0, 0,
+    0, 1,
+};
+
+static const uint8_t gConfigDescriptor[34] = {
+    // configuration
+    9, 0x02, 34, 0, 1, 1, 0, 0xA0, 50,
+    // interface, hid boot mouse
+    9, 0x04, 0, 0, 1, 0x03, 0x01, 0x02, 0,
+    // hid
+    9, 0x21, 0x11, 0x01, 0, 1, 0x22, MOUSE_REPORT_DESC_LENGTH, 0,
+    // endpoint 1 in, interrupt, 4 bytes, 10ms
+    7, 0x05, 0x81, 0x03, 4, 0, 10,
+};
+
+static const uint8_t gReportDescriptor[MOUSE_REPORT_DESC_LENGTH] = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x09, 0x01,
+    0xA1, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x03,
+    0x15, 0x00, 0x25, 0x01, 0x95, 0x03, 0x75, 0x01,
+    0x81, 0x02, 0x95, 0x01, 0x75, 0x05, 0x81, 0x01,
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x15, 0x81,
+    0x25, 0x7F, 0x75, 0x08, 0x95, 0x02, 0x81, 0x06,
+    0xC0, 0xC0,
+};
+
+void cycleStatsAdd(struct CycleStats* stats, avr_cycle_count_t value) {
+    if (stats->count == 0 || value < stats->min) {
+        stats->min = value;
+    }
+
+    if (value > stats->max) {
+        stats->max = value;
+    }
+
+    stats->total += value;
+    ++stats->count;
+}
+
+static avr_cycle_count_t nsToCycles(struct Ch375Model* model, uint32_t ns) {
+    return ((avr_cycle_count_t)ns * model->avr->frequency + 999999999) / 1000000000;
+}
+
+static void setDataBus(struct Ch375Model* model, uint8_t value) {
+    for (int i = 0; i < 8; ++i) {
+        avr_raise_irq(model->dataPins[i], (value >> i) & 1);
+    }
+}
+
+static uint8_t readDataBus(struct Ch375Model* model) {
+    // the firmware pulls a line low by making it an output
+    uint8_t pulledLow = (model->ddrB & 0x1F) | ((model->ddrC & 0x07) << 5);
+    return ~pulledLow;
+}
+
+static avr_cycle_count_t raiseInterrupt(avr_t* avr, avr_cycle_count_t when, void* param) {
+    struct Ch375Model* model = param;
+    avr_raise_irq(model->intPin, 0);
+    return 0;
+}
+
+static void scheduleInterrupt(struct Ch375Model* model, uint8_t status, uint32_t afterUs) {
+    model->status = status;
+    avr_cycle_timer_cancel(model->avr, raiseInterrupt, model);
+    avr_cycle_timer_register_usec(model->avr, afterUs, raiseInterrupt, model);
+}
+
+static void controlSetup(struct Ch375Model* model) {
+    uint8_t* setup = model->txBuffer;
+    uint8_t request = setup[1];
+    uint16_t value = setup[2] | (setup[3] << 8);
+    uint16_t length = setup[6] | (setup[7] << 8);
+
+    model->controlData = NULL;
+    model->controlLength = 0;
+    model->controlOffset = 0;
+
+    if (request == GET_DESCRIPTOR) {
+        switch (value >> 8) {
+            case 0x01:
+                model->controlData = gDeviceDescriptor;
+                model->controlLength = sizeof(gDeviceDescriptor);
+                break;
+            case 0x02:
+                model->controlData = gConfigDescriptor;
+                model->controlLength = sizeof(gConfigDescriptor);
+                break;
+            case 0x22:
+                model->controlData = gReportDescriptor;
+                model->controlLength = sizeof(gReportDescriptor);
+                break;
+        }
+
+        if (model->controlLength > length) {
+            model->controlLength = length;
+        }
+    } else if (request == SET_CONFIGURATION && (setup[0] & 0x60) == REQUEST_TYPE_STANDARD) {
+        model->configured = value != 0;
+        model->reportToggle = 0;
+        model->ackLost = 0;
+    }
+}
+
+static uint8_t usbTransaction(struct Ch375Model* model, uint8_t endpoint, uint8_t pid) {
+    avr_cycle_count_t now = model->avr->cycle;
+
+    if (!model->attached) {
+        return USB_INT_DISCONNECT;
+    }
+
+    if (endpoint == 0) {
+        if (pid == DEF_USB_PID_SETUP) {
+            controlSetup(model);
+        } else if (pid == DEF_USB_PID_IN) {
+            uint16_t remaining = model->controlLength - model->controlOffset;
+            uint8_t chunk = remaining > 8 ? 8 : remaining;
+
+            if (model->controlData) {
+                memcpy(model->rxBuffer, model->controlData + model->controlOffset, chunk);
+            }
+
+            model->rxLength = chunk;
+            model->controlOffset += chunk;
+        }
+
+        return USB_INT_SUCCESS;
+    }
+
+    if (endpoint == 1 && pid == DEF_USB_PID_IN && model->configured) {
+        if (!model->enumeratedCycle) {
+            model->enumeratedCycle = now;
+        }
+
+        if (!model->ackLost && now - model->lastReport < avr_usec_to_cycles(model->avr, model->reportIntervalUs)) {
+            return USB_INT_RET_FAIL | USB_PID_NAK;
+        }
+
+        uint8_t toggle = model->reportToggle;
+        uint8_t expected = (model->tokenToggle & 0x40) != 0;
+
+        if (toggle != expected) {
+            // the chip ACKs the repeat and throws it away, the device moves
+            // on to the next toggle
+            model->reportToggle ^= 1;
+            model->ackLost = 0;
+            model->rxLength = 0;
+            ++model->toggleErrors;
+            return USB_INT_RET_FAIL | (toggle ? USB_PID_DATA1 : USB_PID_DATA0);
+        }
+
+        ++model->reportCount;
+
+        if (model->ackLossEvery && model->reportCount % model->ackLossEvery == 0) {
+            // the device keeps its toggle and sends this report again
+            model->ackLost = 1;
+        } else {
+            model->reportToggle ^= 1;
+        }
+
+        model->lastReport = now;
+        model->reportMotion = -model->reportMotion;
+
+        model->rxBuffer[0] = 0x01;
+        model->rxBuffer[1] = (uint8_t)model->reportMotion;
+        model->rxBuffer[2] = (uint8_t)-model->reportMotion;
+        model->rxBuffer[3] = 0x00;
+        model->rxLength = 4;
+
+        return USB_INT_SUCCESS;
+    }
+
+    return USB_INT_RET_FAIL | USB_PID_STALL;
+}
+
+static void finishPoll(struct Ch375Model* model, struct CycleStats* stats) {
+    if (model->pollActive) {
+        cycleStatsAdd(stats, model->avr->cycle - model->pollStart);
+        model->pollActive = 0;
+    }
+}
+
+static void writeCommand(struct Ch375Model* model, uint8_t command) {
+    model->command = command;
+    model->dataIndex = 0;
+    model->replyLength = 0;
+    model->replyIndex = 0;
+    ++model->commandCount;
+
+    switch (command) {
+        case GET_IC_VER:
+            model->reply[0] = IC_VERSION;
+            model->replyLength = 1;
+            break;
+        case RESET_ALL:
+            model->mode = 0;
+            model->configured = 0;
+            model->deviceAddress = 0;
+            break;
+        case GET_STATUS:
+            model->reply[0] = model->status;
+            model->replyLength = 1;
+            avr_raise_irq(model->intPin, 1);
+            break;
+        case RD_USB_DATA0:
+        case RD_USB_DATA:
+            model->reply[0] = model->rxLength;
+            memcpy(model->reply + 1, model->rxBuffer, model->rxLength);
+            model->replyLength = model->rxLength + 1;
+            break;
+        case ISSUE_TKN_X:
+            model->pollStart = model->avr->cycle;
+            break;
+    }
+}
+
+static void writeData(struct Ch375Model* model, uint8_t value) {
+    uint8_t index = model->dataIndex++;
+
+    switch (model->command) {
+        case CHECK_EXIST:
+            model->reply[0] = ~value;
+            model->replyLength = 1;
+            break;
+        case SET_USB_MODE:
+            model->mode = value;
+
+            if (value == USBModeReset) {
+                model->configured = 0;
+                model->deviceAddress = 0;
+            } else if (value == USBModeActive && model->attached) {
+                scheduleInterrupt(model, USB_INT_CONNECT, 100);
+            }
+            break;
+        case WR_USB_DATA7:
+            if (index == 0) {
+                model->txLength = 0;
+            } else if (model->txLength < sizeof(model->txBuffer)) {
+                model->txBuffer[model->txLength++] = value;
+            }
+            break;
+        case SET_ADDRESS:
+            model->deviceAddress = value;
+            scheduleInterrupt(model, USB_INT_SUCCESS, model->tokenLatencyUs);
+            break;
+        case ISSUE_TKN_X:
+            if (index == 0) {
+                model->tokenToggle = value;
+            } else {
+                uint8_t endpoint = value >> 4;
+                uint8_t pid = value & 0x0F;
+
+                model->pollActive = endpoint != 0 && pid == DEF_USB_PID_IN;
+                scheduleInterrupt(model, usbTransaction(model, endpoint, pid), model->tokenLatencyUs);
+            }
+            break;
+    }
+}
+
+static uint8_t readData(struct Ch375Model* model) {
+    if (model->replyIndex >= model->replyLength) {
+        return 0xFF;
+    }
+
+    uint8_t result = model->reply[model->replyIndex++];
+
+    if (model->replyIndex == model->replyLength) {
+        if (model->command == GET_STATUS && (result & USB_INT_RET_FAIL)) {
+            finishPoll(model, &model->nakPolls);
+        } else if (model->command == RD_USB_DATA) {
+            finishPoll(model, &model->reportPolls);
+        }
+    }
+
+    return result;
+}
+
+static void checkGap(struct Ch375Model* model) {
+    avr_cycle_count_t now = model->avr->cycle;
+    uint32_t limit = model->lastWasCommand ? model->limits.minCommandGap : model->limits.minStrobeGap;
+
+    if (model->lastStrobeEnd && now - model->lastStrobeEnd < nsToCycles(model, limit)) {
+        ++model->gapViolations;
+    }
+
+    if (model->addressChange && now - model->addressChange < nsToCycles(model, model->limits.minAddressSetup)) {
+        ++model->addressSetupViolations;
+    }
+
+    model->strobeStart = now;
+}
+
+static void checkWidth(struct Ch375Model* model) {
+    avr_cycle_count_t now = model->avr->cycle;
+
+    if (now - model->strobeStart < nsToCycles(model, model->limits.minStrobeWidth)) {
+        ++model->strobeViolations;
+    }
+
+    model->lastStrobeEnd = now;
+}
+
+static void checkAddressChange(struct Ch375Model* model, uint8_t previous) {
+    avr_cycle_count_t now = model->avr->cycle;
+
+    if (previous & (USB_WR | USB_RD)) {
+        // changed during a strobe or in the same write that ended it
+        ++model->addressHoldViolations;
+    } else if (model->lastStrobeEnd && now - model->lastStrobeEnd < nsToCycles(model, model->limits.minAddressHold)) {
+        ++model->addressHoldViolations;
+    }
+
+    // a strobe starting in the same write is caught by the setup check
+    model->addressChange = now;
+}
+
+static void portDDirection(struct avr_irq_t* irq, uint32_t value, void* param) {
+    struct Ch375Model* model = param;
+    uint8_t previous = model->ddrD;
+    uint8_t changed = previous ^ value;
+    model->ddrD = value;
+
+    if (changed & USB_A0) {
+        checkAddressChange(model, previous);
+    }
+
+    if (changed & USB_WR) {
+        if (value & USB_WR) {
+            checkGap(model);
+        } else {
+            checkWidth(model);
+
+            // A0 is pulled low for data and left high for commands
+            uint8_t isCommand = !(value & USB_A0);
+            uint8_t byte = readDataBus(model);
+
+            if (isCommand) {
+                writeCommand(model, byte);
+            } else {
+                writeData(model, byte);
+            }
+
+            model->lastWasCommand = isCommand;
+        }
+    }
+
+    if (changed & USB_RD) {
+        if (value & USB_RD) {
+            checkGap(model);
+
+            if ((model->ddrB & 0x1F) || (model->ddrC & 0x07)) {
+                ++model->contentionViolations;
+            }
+
+            setDataBus(model, readData(model));
+        } else {
+            checkWidth(model);
+            model->lastWasCommand = 0;
+            setDataBus(model, 0xFF);
+        }
+    }
+
+    if ((changed & N64_LINE) && model->onJoybusDrive) {
+        model->onJoybusDrive(model->joybusParam, (value & N64_LINE) != 0);
+    }
+}
+
+static void portBDirection(struct avr_irq_t* irq, uint32_t value, void* param) {
+    ((struct Ch375Model*)param)->ddrB = value;
+}
+
+static void portCDirection(struct avr_irq_t* irq, uint32_t value, void* param) {
+    ((struct Ch375Model*)param)->ddrC = value;
+}
+
+static avr_cycle_count_t attachDevice(avr_t* avr, avr_cycle_count_t when, void* param) {
+    struct Ch375Model* model = param;
+    model->attached = 1;
+    model->attachCycle = when;
+    scheduleInterrupt(model, USB_INT_CONNECT, 1);
+    return 0;
+}
+
+void ch375ModelInit(struct Ch375Model* model, avr_t* avr, struct BusTimingLimits* limits) {
+    memset(model, 0, sizeof(*model));
+    model->avr = avr;
+    model->limits = *limits;
+    model->tokenLatencyUs = 50;
+    model->reportIntervalUs = 10000;
+    model->reportMotion = 1;
+    model->status = 0;
+
+    for (int i = 0; i < 5; ++i) {
+        model->dataPins[i] = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), i);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        model->dataPins[i + 5] = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), i);
+    }
+
+    model->intPin = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 3);
+
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), IOPORT_IRQ_DIRECTION_ALL), portBDirection, model);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), IOPORT_IRQ_DIRECTION_ALL), portCDirection, model);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), IOPORT_IRQ_DIRECTION_ALL), portDDirection, model);
+
+    // external pull ups
+    setDataBus(model, 0xFF);
+    avr_raise_irq(model->intPin, 1);
+}
+
+void ch375ModelAttach(struct Ch375Model* model, uint32_t afterUs) {
+    avr_cycle_timer_register_usec(model->avr, afterUs, attachDevice, model);
+}
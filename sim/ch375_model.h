@@ -0,0 +1,102 @@
+#ifndef __CH375_MODEL_H__
+#define __CH375_MODEL_H__
+
+#include <stdint.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_irq.h>
+
+// minimum timings the parallel bus is checked against, in ns
+struct BusTimingLimits {
+    uint32_t minStrobeWidth;
+    uint32_t minStrobeGap;
+    uint32_t minCommandGap;
+    // A0 has to be stable this long before RD or WR goes low
+    uint32_t minAddressSetup;
+    // and stay stable this long after it goes high again
+    uint32_t minAddressHold;
+};
+
+struct CycleStats {
+    uint32_t count;
+    avr_cycle_count_t min;
+    avr_cycle_count_t max;
+    avr_cycle_count_t total;
+};
+
+struct Ch375Model {
+    avr_t* avr;
+    avr_irq_t* dataPins[8];
+    avr_irq_t* intPin;
+
+    uint8_t ddrB;
+    uint8_t ddrC;
+    uint8_t ddrD;
+
+    // bus timing
+    struct BusTimingLimits limits;
+    avr_cycle_count_t strobeStart;
+    avr_cycle_count_t lastStrobeEnd;
+    uint8_t lastWasCommand;
+    avr_cycle_count_t addressChange;
+    uint32_t strobeViolations;
+    uint32_t gapViolations;
+    uint32_t contentionViolations;
+    uint32_t addressSetupViolations;
+    uint32_t addressHoldViolations;
+
+    // command interpreter
+    uint8_t command;
+    uint8_t dataIndex;
+    uint8_t reply[72];
+    uint8_t replyLength;
+    uint8_t replyIndex;
+    // written by WR_USB_DATA7
+    uint8_t txBuffer[64];
+    uint8_t txLength;
+    // returned by RD_USB_DATA
+    uint8_t rxBuffer[64];
+    uint8_t rxLength;
+    uint8_t tokenToggle;
+    uint8_t status;
+    uint8_t mode;
+    uint32_t tokenLatencyUs;
+
+    // emulated boot mouse
+    uint8_t attached;
+    uint8_t deviceAddress;
+    uint8_t configured;
+    const uint8_t* controlData;
+    uint16_t controlLength;
+    uint16_t controlOffset;
+    avr_cycle_count_t lastReport;
+    uint32_t reportIntervalUs;
+    int8_t reportMotion;
+    // toggle of the next report on endpoint 1
+    uint8_t reportToggle;
+    // the last report's ACK was missed, it's sent again with the same toggle
+    uint8_t ackLost;
+    // miss the ACK of every nth report, 0 never does
+    uint32_t ackLossEvery;
+    uint32_t reportCount;
+    uint32_t toggleErrors;
+
+    // measurements
+    avr_cycle_count_t attachCycle;
+    avr_cycle_count_t enumeratedCycle;
+    avr_cycle_count_t pollStart;
+    uint8_t pollActive;
+    struct CycleStats reportPolls;
+    struct CycleStats nakPolls;
+    uint32_t commandCount;
+
+    // forwarded changes on the N64 line, PD2
+    void (*onJoybusDrive)(void* param, int low);
+    void* joybusParam;
+};
+
+void ch375ModelInit(struct Ch375Model* model, avr_t* avr, struct BusTimingLimits* limits);
+void ch375ModelAttach(struct Ch375Model* model, uint32_t afterUs);
+void cycleStatsAdd(struct CycleStats* stats, avr_cycle_count_t value);
+
+#endif
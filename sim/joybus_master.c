@@ -0,0 +1,109 @@
+#include "joybus_master.h"
+
+#include <string.h>
+
+#include <simavr/avr_ioport.h>
+#include <simavr/sim_time.h>
+#include <simavr/sim_cycle_timers.h>
+
+#define JOYBUS_BIT_US       4
+#define JOYBUS_SHORT_US     1
+#define JOYBUS_LONG_US      3
+
+static avr_cycle_count_t responseTimeout(avr_t* avr, avr_cycle_count_t when, void* param) {
+    struct JoybusMaster* master = param;
+
+    if (master->waiting) {
+        master->waiting = 0;
+        ++master->noResponse;
+    }
+
+    return 0;
+}
+
+static avr_cycle_count_t sendEdge(avr_t* avr, avr_cycle_count_t when, void* param) {
+    struct JoybusMaster* master = param;
+
+    avr_raise_irq(master->line, master->levels[master->edgeIndex]);
+    ++master->edgeIndex;
+
+    if (master->edgeIndex < master->edgeCount) {
+        return master->edges[master->edgeIndex];
+    }
+
+    master->sending = 0;
+    master->waiting = 1;
+    master->commandEnd = when;
+    avr_cycle_timer_register_usec(avr, master->responseTimeoutUs, responseTimeout, master);
+
+    return 0;
+}
+
+static void addEdge(struct JoybusMaster* master, avr_cycle_count_t when, uint8_t level) {
+    master->edges[master->edgeCount] = when;
+    master->levels[master->edgeCount] = level;
+    ++master->edgeCount;
+}
+
+static avr_cycle_count_t startPoll(avr_t* avr, avr_cycle_count_t when, void* param) {
+    struct JoybusMaster* master = param;
+    avr_cycle_count_t bit = avr_usec_to_cycles(avr, JOYBUS_BIT_US);
+    avr_cycle_count_t shortLow = avr_usec_to_cycles(avr, JOYBUS_SHORT_US);
+    avr_cycle_count_t longLow = avr_usec_to_cycles(avr, JOYBUS_LONG_US);
+
+    // a late response to the last poll is ignored
+    master->waiting = 0;
+    master->edgeCount = 0;
+    master->edgeIndex = 0;
+
+    for (int i = 0; i < 8; ++i) {
+        avr_cycle_count_t start = when + bit * i;
+        int one = (master->command >> (7 - i)) & 1;
+
+        addEdge(master, start, 0);
+        addEdge(master, start + (one ? shortLow : longLow), 1);
+    }
+
+    // console stop bit
+    addEdge(master, when + bit * 8, 0);
+    addEdge(master, when + bit * 8 + shortLow, 1);
+
+    master->sending = 1;
+    ++master->polls;
+
+    // the first edge is now, the timer handles the rest
+    avr_raise_irq(master->line, master->levels[0]);
+    master->edgeIndex = 1;
+    avr_cycle_timer_register(avr, master->edges[1] - when, sendEdge, master);
+
+    return when + avr_usec_to_cycles(avr, master->periodUs);
+}
+
+void joybusMasterDeviceDrive(void* param, int low) {
+    struct JoybusMaster* master = param;
+
+    if (!low) {
+        return;
+    }
+
+    if (master->sending) {
+        ++master->collisions;
+    } else if (master->waiting) {
+        master->waiting = 0;
+        cycleStatsAdd(&master->latency, master->avr->cycle - master->commandEnd);
+    }
+}
+
+void joybusMasterInit(struct JoybusMaster* master, avr_t* avr, uint8_t command, uint32_t periodUs) {
+    memset(master, 0, sizeof(*master));
+    master->avr = avr;
+    master->command = command;
+    master->periodUs = periodUs;
+    master->responseTimeoutUs = 100;
+    master->line = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 2);
+
+    // idle high through the console's pull up
+    avr_raise_irq(master->line, 1);
+
+    avr_cycle_timer_register_usec(avr, periodUs, startPoll, master);
+}
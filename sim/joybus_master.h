@@ -0,0 +1,42 @@
+#ifndef __JOYBUS_MASTER_H__
+#define __JOYBUS_MASTER_H__
+
+#include <stdint.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_irq.h>
+
+#include "ch375_model.h"
+
+// 8 command bits and a stop bit, two edges each
+#define JOYBUS_MAX_EDGES    18
+
+// console side of the controller port, polls pin 2 like a game would
+struct JoybusMaster {
+    avr_t* avr;
+    avr_irq_t* line;
+
+    uint32_t periodUs;
+    uint32_t responseTimeoutUs;
+    uint8_t command;
+
+    avr_cycle_count_t edges[JOYBUS_MAX_EDGES];
+    uint8_t levels[JOYBUS_MAX_EDGES];
+    uint8_t edgeCount;
+    uint8_t edgeIndex;
+
+    uint8_t sending;
+    uint8_t waiting;
+    avr_cycle_count_t commandEnd;
+
+    uint32_t polls;
+    uint32_t noResponse;
+    uint32_t collisions;
+    struct CycleStats latency;
+};
+
+void joybusMasterInit(struct JoybusMaster* master, avr_t* avr, uint8_t command, uint32_t periodUs);
+// called when the firmware starts or stops pulling the line low
+void joybusMasterDeviceDrive(void* param, int low);
+
+#endif
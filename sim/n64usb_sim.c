@@ -0,0 +1,211 @@
+// runs the firmware ELF under simavr with a CH375B and an N64 console
+// attached and reports bus timing problems and cycle counts for the hot
+// paths. exits non zero if anything fails so it can gate a build.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_time.h>
+
+#include "ch375_model.h"
+#include "joybus_master.h"
+
+#define CPU_FREQUENCY       16000000
+
+// the firmware's nop padding was tuned against real hardware, these are
+// the margins it has to keep
+#define DEFAULT_STROBE_WIDTH_NS     100
+#define DEFAULT_STROBE_GAP_NS       500
+#define DEFAULT_COMMAND_GAP_NS      500
+// a single AVR cycle is 62.5ns, these catch A0 changing in the same write
+// as a strobe edge
+#define DEFAULT_ADDRESS_SETUP_NS    20
+#define DEFAULT_ADDRESS_HOLD_NS     20
+
+#define JOYBUS_POLL_STATUS          0x01
+
+static void usage(const char* name) {
+    fprintf(stderr,
+        "usage: %s [options] firmware.elf\n"
+        "  -t ms     simulated time to run (default 2000)\n"
+        "  -a ms     when the mouse is plugged in (default 100)\n"
+        "  -l us     CH375B token latency (default 50)\n"
+        "  -T n      the mouse misses every nth ACK and resends the report\n"
+        "            with a stale toggle, 0 disables (default 0)\n"
+        "  -p us     console poll period, 0 disables (default 16667)\n"
+        "  -w ns     minimum RD/WR strobe width (default %d)\n"
+        "  -g ns     minimum gap between strobes (default %d)\n"
+        "  -c ns     minimum gap after a command byte (default %d)\n"
+        "  -s ns     minimum A0 setup before RD/WR goes low (default %d)\n"
+        "  -H ns     minimum A0 hold after RD/WR goes high (default %d)\n"
+        "  -P cycles fail if a report poll takes longer than this\n"
+        "  -j        fail if the console never gets a response\n",
+        name, DEFAULT_STROBE_WIDTH_NS, DEFAULT_STROBE_GAP_NS, DEFAULT_COMMAND_GAP_NS,
+        DEFAULT_ADDRESS_SETUP_NS, DEFAULT_ADDRESS_HOLD_NS);
+}
+
+static void printStats(const char* name, struct CycleStats* stats) {
+    if (stats->count == 0) {
+        printf("%-22s none\n", name);
+        return;
+    }
+
+    printf("%-22s n=%u min=%llu avg=%llu max=%llu cycles\n",
+        name,
+        stats->count,
+        (unsigned long long)stats->min,
+        (unsigned long long)(stats->total / stats->count),
+        (unsigned long long)stats->max);
+}
+
+int main(int argc, char** argv) {
+    uint32_t runMs = 2000;
+    uint32_t attachMs = 100;
+    uint32_t tokenLatencyUs = 50;
+    uint32_t ackLossEvery = 0;
+    uint32_t joybusPeriodUs = 16667;
+    uint32_t maxPollCycles = 0;
+    int requireJoybus = 0;
+    struct BusTimingLimits limits = {
+        DEFAULT_STROBE_WIDTH_NS,
+        DEFAULT_STROBE_GAP_NS,
+        DEFAULT_COMMAND_GAP_NS,
+        DEFAULT_ADDRESS_SETUP_NS,
+        DEFAULT_ADDRESS_HOLD_NS,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:a:l:T:p:w:g:c:s:H:P:jh")) != -1) {
+        switch (opt) {
+            case 't': runMs = strtoul(optarg, NULL, 0); break;
+            case 'a': attachMs = strtoul(optarg, NULL, 0); break;
+            case 'l': tokenLatencyUs = strtoul(optarg, NULL, 0); break;
+            case 'T': ackLossEvery = strtoul(optarg, NULL, 0); break;
+            case 'p': joybusPeriodUs = strtoul(optarg, NULL, 0); break;
+            case 'w': limits.minStrobeWidth = strtoul(optarg, NULL, 0); break;
+            case 'g': limits.minStrobeGap = strtoul(optarg, NULL, 0); break;
+            case 'c': limits.minCommandGap = strtoul(optarg, NULL, 0); break;
+            case 's': limits.minAddressSetup = strtoul(optarg, NULL, 0); break;
+            case 'H': limits.minAddressHold = strtoul(optarg, NULL, 0); break;
+            case 'P': maxPollCycles = strtoul(optarg, NULL, 0); break;
+            case 'j': requireJoybus = 1; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+
+    if (elf_read_firmware(argv[optind], &firmware) != 0) {
+        fprintf(stderr, "could not read %s\n", argv[optind]);
+        return 2;
+    }
+
+    // Arduino builds don't carry the mcu section
+    strcpy(firmware.mmcu, "atmega328p");
+    firmware.frequency = CPU_FREQUENCY;
+
+    avr_t* avr = avr_make_mcu_by_name(firmware.mmcu);
+
+    if (!avr) {
+        fprintf(stderr, "simavr doesn't support %s\n", firmware.mmcu);
+        return 2;
+    }
+
+    avr_init(avr);
+    avr_load_firmware(avr, &firmware);
+
+    struct Ch375Model ch375;
+    ch375ModelInit(&ch375, avr, &limits);
+    ch375.tokenLatencyUs = tokenLatencyUs;
+    ch375.ackLossEvery = ackLossEvery;
+    ch375ModelAttach(&ch375, attachMs * 1000);
+
+    struct JoybusMaster joybus;
+    if (joybusPeriodUs) {
+        joybusMasterInit(&joybus, avr, JOYBUS_POLL_STATUS, joybusPeriodUs);
+        ch375.onJoybusDrive = joybusMasterDeviceDrive;
+        ch375.joybusParam = &joybus;
+    }
+
+    avr_cycle_count_t endCycle = avr_usec_to_cycles(avr, runMs * 1000);
+    int state = cpu_Running;
+
+    while (avr->cycle < endCycle) {
+        state = avr_run(avr);
+
+        if (state == cpu_Done || state == cpu_Crashed) {
+            break;
+        }
+    }
+
+    int failed = 0;
+
+    printf("simulated              %llu cycles\n", (unsigned long long)avr->cycle);
+
+    if (state == cpu_Crashed) {
+        printf("firmware crashed\n");
+        failed = 1;
+    }
+
+    printf("ch375 commands         %u\n", ch375.commandCount);
+    printf("strobe width errors    %u\n", ch375.strobeViolations);
+    printf("strobe gap errors      %u\n", ch375.gapViolations);
+    printf("bus contention errors  %u\n", ch375.contentionViolations);
+    printf("A0 setup errors        %u\n", ch375.addressSetupViolations);
+    printf("A0 hold errors         %u\n", ch375.addressHoldViolations);
+
+    if (ch375.strobeViolations || ch375.gapViolations || ch375.contentionViolations ||
+        ch375.addressSetupViolations || ch375.addressHoldViolations) {
+        failed = 1;
+    }
+
+    if (ch375.enumeratedCycle) {
+        printf("enumeration            %llu cycles\n", (unsigned long long)(ch375.enumeratedCycle - ch375.attachCycle));
+    } else {
+        printf("enumeration            never finished\n");
+        failed = 1;
+    }
+
+    printStats("report poll", &ch375.reportPolls);
+    printStats("nak poll", &ch375.nakPolls);
+    printf("toggle errors          %u\n", ch375.toggleErrors);
+
+    // every missed ACK should cost exactly one toggle error before the
+    // firmware resyncs
+    if (ackLossEvery && ch375.toggleErrors > ch375.reportCount / ackLossEvery + 1) {
+        printf("toggle never resynced\n");
+        failed = 1;
+    }
+
+    if (maxPollCycles && ch375.reportPolls.max > maxPollCycles) {
+        printf("report poll over the %u cycle budget\n", maxPollCycles);
+        failed = 1;
+    }
+
+    if (joybusPeriodUs) {
+        printf("console polls          %u\n", joybus.polls);
+        printf("console no response    %u\n", joybus.noResponse);
+        printf("console collisions     %u\n", joybus.collisions);
+        printStats("console latency", &joybus.latency);
+
+        if (joybus.collisions || (requireJoybus && joybus.latency.count == 0)) {
+            failed = 1;
+        }
+    }
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+
+    return failed;
+}
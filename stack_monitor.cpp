@@ -0,0 +1,49 @@
+#include "stack_monitor.h"
+
+#include <Arduino.h>
+
+#include "debug_print.h"
+#include "messages.h"
+
+// provided by the linker, _end is the first byte after .data and .bss
+extern uint8_t _end;
+extern uint8_t __stack;
+
+void stackPaint() __attribute__((naked, used, section(".init1")));
+
+// runs before the c runtime is set up so it can't use the stack or rely
+// on r1 being zero
+void stackPaint() {
+  asm volatile (
+    "    ldi r30, lo8(_end)\n"
+    "    ldi r31, hi8(_end)\n"
+    "    ldi r24, %0\n"
+    "    ldi r25, hi8(__stack)\n"
+    "    rjmp 2f\n"
+    "1:\n"
+    "    st Z+, r24\n"
+    "2:\n"
+    "    cpi r30, lo8(__stack)\n"
+    "    cpc r31, r25\n"
+    "    brlo 1b\n"
+    "    breq 1b\n"
+    :
+    : "i" (STACK_CANARY)
+  );
+}
+
+uint16_t stackUnusedBytes() {
+  uint8_t* curr = &_end;
+  uint16_t result = 0;
+
+  while (curr <= &__stack && *curr == STACK_CANARY) {
+    ++curr;
+    ++result;
+  }
+
+  return result;
+}
+
+void printStackReport() {
+  printMessageWord(MessageStackFree, stackUnusedBytes());
+}
@@ -0,0 +1,14 @@
+#ifndef __STACK_MONITOR_H__
+#define __STACK_MONITOR_H__
+
+#include <stdint.h>
+
+// free ram is filled with this at startup, anything the stack touches
+// stops matching
+#define STACK_CANARY    0xC5
+
+// bytes between the end of static data and the deepest the stack has reached
+uint16_t stackUnusedBytes();
+void printStackReport();
+
+#endif
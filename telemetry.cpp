@@ -0,0 +1,357 @@
+#include "telemetry.h"
+
+#if TELEMETRY
+
+#include <string.h>
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#include "usb_hid.h"
+#include "runtime_params.h"
+#include "stack_monitor.h"
+#include "timebase.h"
+
+volatile uint8_t gTelemetryTxRing[TELEMETRY_TX_SIZE];
+volatile uint8_t gTelemetryTxHead;
+volatile uint8_t gTelemetryTxTail;
+
+volatile uint8_t gTelemetryRxRing[TELEMETRY_RX_SIZE];
+volatile uint8_t gTelemetryRxHead;
+volatile uint8_t gTelemetryRxTail;
+volatile uint16_t gTelemetryRxOverruns;
+
+// encoded command being collected from the rx ring
+uint8_t gCommand[TELEMETRY_MAX_COMMAND];
+uint8_t gCommandLength;
+bool gCommandOverflow;
+
+uint16_t gFramesSent;
+uint16_t gFramesDropped;
+uint16_t gBadFrames;
+
+ISR(USART_UDRE_vect) {
+  if (gTelemetryTxHead == gTelemetryTxTail) {
+    // nothing left to send
+    UCSR0B &= ~(1 << UDRIE0);
+    return;
+  }
+
+  UDR0 = gTelemetryTxRing[gTelemetryTxTail];
+  gTelemetryTxTail = (gTelemetryTxTail + 1) & (TELEMETRY_TX_SIZE - 1);
+}
+
+ISR(USART_RX_vect) {
+  // a damaged byte is still queued, the frame's crc will reject it
+  if (UCSR0A & ((1 << DOR0) | (1 << FE0))) {
+    ++gTelemetryRxOverruns;
+  }
+
+  uint8_t next = UDR0;
+  uint8_t head = (gTelemetryRxHead + 1) & (TELEMETRY_RX_SIZE - 1);
+
+  if (head == gTelemetryRxTail) {
+    ++gTelemetryRxOverruns;
+    return;
+  }
+
+  gTelemetryRxRing[gTelemetryRxHead] = next;
+  gTelemetryRxHead = head;
+}
+
+void telemetryInit() {
+  uint16_t ubrr = (F_CPU / 8 / TELEMETRY_BAUD) - 1;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    gTelemetryTxHead = 0;
+    gTelemetryTxTail = 0;
+    gTelemetryRxHead = 0;
+    gTelemetryRxTail = 0;
+    gTelemetryRxOverruns = 0;
+
+    UBRR0 = ubrr;
+    UCSR0A = (1 << U2X0);
+    // 8 data bits, no parity, 1 stop bit
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UCSR0B = (1 << RXEN0) | (1 << TXEN0) | (1 << RXCIE0);
+  }
+
+  gCommandLength = 0;
+  gCommandOverflow = false;
+}
+
+uint8_t telemetryTxFree() {
+  // one slot stays empty to tell a full ring from an empty one
+  return (uint8_t)(gTelemetryTxTail - gTelemetryTxHead - 1) & (TELEMETRY_TX_SIZE - 1);
+}
+
+bool telemetrySend(uint8_t type, const uint8_t* payload, uint8_t length) {
+  if (length > TELEMETRY_MAX_PAYLOAD) {
+    ++gFramesDropped;
+    return false;
+  }
+
+  if (telemetryTxFree() < TELEMETRY_ENCODED_SIZE(length + 3)) {
+    ++gFramesDropped;
+    return false;
+  }
+
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  uint16_t crc = _crc_ccitt_update(TELEMETRY_CRC_INIT, type);
+
+  frame[0] = type;
+
+  for (uint8_t i = 0; i < length; ++i) {
+    frame[i + 1] = payload[i];
+    crc = _crc_ccitt_update(crc, payload[i]);
+  }
+
+  frame[length + 1] = (uint8_t)crc;
+  frame[length + 2] = (uint8_t)(crc >> 8);
+
+  // COBS, each code byte is the distance to the next zero. The frame is
+  // written past the head and only published once it is complete so the
+  // isr never sends part of a frame
+  uint8_t head = gTelemetryTxHead;
+  uint8_t codeIndex = head;
+  uint8_t code = 1;
+
+  head = (head + 1) & (TELEMETRY_TX_SIZE - 1);
+
+  for (uint8_t i = 0; i < length + 3; ++i) {
+    if (frame[i] == 0) {
+      gTelemetryTxRing[codeIndex] = code;
+      codeIndex = head;
+      code = 1;
+    } else {
+      gTelemetryTxRing[head] = frame[i];
+      ++code;
+    }
+
+    head = (head + 1) & (TELEMETRY_TX_SIZE - 1);
+  }
+
+  gTelemetryTxRing[codeIndex] = code;
+  gTelemetryTxRing[head] = 0;
+  head = (head + 1) & (TELEMETRY_TX_SIZE - 1);
+
+  gTelemetryTxHead = head;
+  UCSR0B |= (1 << UDRIE0);
+
+  ++gFramesSent;
+
+  return true;
+}
+
+void telemetrySendLog(uint8_t id, const uint8_t* value, uint8_t valueLength) {
+  uint8_t payload[3];
+
+  if (valueLength > sizeof(payload) - 1) {
+    valueLength = sizeof(payload) - 1;
+  }
+
+  payload[0] = id;
+  memcpy(payload + 1, value, valueLength);
+
+  telemetrySend(TELEMETRY_FRAME_LOG, payload, valueLength + 1);
+}
+
+void telemetrySendReport(uint8_t deviceType, struct N64ControllerState* state) {
+  uint16_t now = timeNow();
+  uint8_t payload[7];
+
+  payload[0] = (uint8_t)now;
+  payload[1] = (uint8_t)(now >> 8);
+  payload[2] = deviceType;
+  payload[3] = (uint8_t)state->buttons;
+  payload[4] = (uint8_t)(state->buttons >> 8);
+  payload[5] = (uint8_t)state->stickX;
+  payload[6] = (uint8_t)state->stickY;
+
+  telemetrySend(TELEMETRY_FRAME_REPORT, payload, sizeof(payload));
+}
+
+uint16_t telemetryTicksToUs(uint16_t ticks) {
+  return ticks > 0xFFFF / 4 ? 0xFFFF : ticks * 4;
+}
+
+void telemetrySendCounters() {
+  struct UsbPollStats* stats = usbGetPollStats();
+  struct TelemetryCounters counters;
+
+  counters.polls = stats->polls;
+  counters.reports = stats->results[UsbPollResultReport];
+  counters.naks = stats->results[UsbPollResultNak];
+  counters.stalls = stats->results[UsbPollResultStall];
+  counters.timeouts = stats->results[UsbPollResultTimeout];
+  counters.toggleErrors = stats->results[UsbPollResultToggleError];
+  counters.disconnects = stats->results[UsbPollResultDisconnect];
+  counters.errors = stats->results[UsbPollResultError];
+  counters.clearHalts = stats->clearHalts;
+  counters.oversizeReports = stats->oversizeReports;
+  counters.undecodedReports = stats->undecodedReports;
+  counters.recoveries = stats->recoveries;
+  counters.failedRecoveries = stats->failedRecoveries;
+  counters.lastRecoveryMs = stats->lastRecoveryMs;
+  counters.maxRecoveryMs = stats->maxRecoveryMs;
+  counters.enumerationMs = stats->enumerationMs;
+  counters.lastPollUs = telemetryTicksToUs(stats->lastPollTicks);
+  counters.maxPollUs = telemetryTicksToUs(stats->maxPollTicks);
+  counters.framesSent = gFramesSent;
+  counters.framesDropped = gFramesDropped;
+  counters.badFrames = gBadFrames;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    counters.rxOverruns = gTelemetryRxOverruns;
+  }
+
+  counters.stackFree = stackUnusedBytes();
+
+  telemetrySend(TELEMETRY_FRAME_COUNTERS, (uint8_t*)&counters, sizeof(counters));
+}
+
+void telemetryResetCounters() {
+  usbResetPollStats();
+
+  gFramesSent = 0;
+  gFramesDropped = 0;
+  gBadFrames = 0;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    gTelemetryRxOverruns = 0;
+  }
+}
+
+void telemetrySendError(uint8_t command, uint8_t error) {
+  uint8_t payload[2] = { command, error };
+  telemetrySend(TELEMETRY_FRAME_ERROR, payload, sizeof(payload));
+}
+
+void telemetrySendParam(uint8_t param) {
+  uint16_t value;
+
+  if (!runtimeParamGet(param, &value)) {
+    telemetrySendError(TELEMETRY_CMD_GET_PARAM, TELEMETRY_ERROR_BAD_PARAM);
+    return;
+  }
+
+  uint8_t payload[3] = { param, (uint8_t)value, (uint8_t)(value >> 8) };
+  telemetrySend(TELEMETRY_FRAME_PARAM, payload, sizeof(payload));
+}
+
+// decodes in place, returns the decoded length or 0 if the data isn't valid COBS
+uint8_t cobsDecode(uint8_t* data, uint8_t length) {
+  uint8_t read = 0;
+  uint8_t write = 0;
+
+  while (read < length) {
+    uint8_t code = data[read++];
+
+    if (code == 0 || read + code - 1 > length) {
+      return 0;
+    }
+
+    for (uint8_t i = 1; i < code; ++i) {
+      data[write++] = data[read++];
+    }
+
+    if (code != 0xFF && read < length) {
+      data[write++] = 0;
+    }
+  }
+
+  return write;
+}
+
+void telemetryHandleCommand(uint8_t* frame, uint8_t length) {
+  // type and crc at least
+  if (length < 3) {
+    ++gBadFrames;
+    return;
+  }
+
+  uint16_t crc = TELEMETRY_CRC_INIT;
+
+  for (uint8_t i = 0; i < length - 2; ++i) {
+    crc = _crc_ccitt_update(crc, frame[i]);
+  }
+
+  if (frame[length - 2] != (uint8_t)crc || frame[length - 1] != (uint8_t)(crc >> 8)) {
+    ++gBadFrames;
+    return;
+  }
+
+  uint8_t command = frame[0];
+  uint8_t* payload = frame + 1;
+  uint8_t payloadLength = length - 3;
+
+  switch (command) {
+    case TELEMETRY_CMD_GET_COUNTERS:
+      telemetrySendCounters();
+      break;
+    case TELEMETRY_CMD_RESET_COUNTERS:
+      telemetryResetCounters();
+      telemetrySendCounters();
+      break;
+    case TELEMETRY_CMD_GET_PARAM:
+      if (payloadLength != 1) {
+        telemetrySendError(command, TELEMETRY_ERROR_BAD_LENGTH);
+        break;
+      }
+      telemetrySendParam(payload[0]);
+      break;
+    case TELEMETRY_CMD_SET_PARAM:
+      if (payloadLength != 3) {
+        telemetrySendError(command, TELEMETRY_ERROR_BAD_LENGTH);
+        break;
+      }
+      if (payload[0] >= PARAM_COUNT) {
+        telemetrySendError(command, TELEMETRY_ERROR_BAD_PARAM);
+        break;
+      }
+      if (!runtimeParamSet(payload[0], payload[1] | ((uint16_t)payload[2] << 8))) {
+        telemetrySendError(command, TELEMETRY_ERROR_BAD_VALUE);
+        break;
+      }
+      telemetrySendParam(payload[0]);
+      break;
+    default:
+      telemetrySendError(command, TELEMETRY_ERROR_UNKNOWN_COMMAND);
+      break;
+  }
+}
+
+void telemetryUpdate() {
+  while (gTelemetryRxTail != gTelemetryRxHead) {
+    uint8_t next = gTelemetryRxRing[gTelemetryRxTail];
+    gTelemetryRxTail = (gTelemetryRxTail + 1) & (TELEMETRY_RX_SIZE - 1);
+
+    if (next != 0) {
+      if (gCommandLength < TELEMETRY_MAX_COMMAND) {
+        gCommand[gCommandLength++] = next;
+      } else {
+        gCommandOverflow = true;
+      }
+      continue;
+    }
+
+    if (gCommandOverflow) {
+      ++gBadFrames;
+    } else if (gCommandLength) {
+      uint8_t length = cobsDecode(gCommand, gCommandLength);
+
+      if (length) {
+        telemetryHandleCommand(gCommand, length);
+      } else {
+        ++gBadFrames;
+      }
+    }
+
+    gCommandLength = 0;
+    gCommandOverflow = false;
+  }
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "debug_print.h"
+#include "telemetry_protocol.h"
+#include "n64_controller.h"
+
+// sizes must be powers of 2
+#define TELEMETRY_TX_SIZE       128
+#define TELEMETRY_RX_SIZE       32
+// longest command frame accepted from the host, encoded
+#define TELEMETRY_MAX_COMMAND   16
+
+#if TELEMETRY
+
+// takes over USART0 from the Arduino core
+void telemetryInit();
+// handles commands from the host, never waits on the uart
+void telemetryUpdate();
+// queues a frame if the whole frame fits in the tx ring, otherwise it is
+// dropped and counted
+bool telemetrySend(uint8_t type, const uint8_t* payload, uint8_t length);
+void telemetrySendLog(uint8_t id, const uint8_t* value, uint8_t valueLength);
+void telemetrySendReport(uint8_t deviceType, struct N64ControllerState* state);
+
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef __TELEMETRY_PROTOCOL_H__
+#define __TELEMETRY_PROTOCOL_H__
+
+#include <stdint.h>
+
+// shared with tools/n64usb_telemetry.c
+//
+// a frame is [type][payload][crc low][crc high], COBS encoded and ended
+// with a 0 byte. The crc is avr-libc's _crc_ccitt_update over the type
+// and payload starting from TELEMETRY_CRC_INIT (CRC-16/MCRF4XX)
+#define TELEMETRY_BAUD              500000
+#define TELEMETRY_CRC_INIT          0xFFFF
+#define TELEMETRY_MAX_PAYLOAD       52
+// type, payload and crc
+#define TELEMETRY_MAX_FRAME         (TELEMETRY_MAX_PAYLOAD + 3)
+// frames are under 254 bytes so COBS adds one byte, plus the delimiter
+#define TELEMETRY_ENCODED_SIZE(frameLength) ((frameLength) + 2)
+
+// device to host
+
+// payload is struct TelemetryCounters
+#define TELEMETRY_FRAME_COUNTERS        0x01
+// time(u16, timebase ticks) deviceType(u8) buttons(u16) stickX(i8) stickY(i8)
+#define TELEMETRY_FRAME_REPORT          0x02
+// message id from messages.h, followed by a u8 or u16 value for messages
+// that have one
+#define TELEMETRY_FRAME_LOG             0x03
+// param(u8) value(u16)
+#define TELEMETRY_FRAME_PARAM           0x04
+// command(u8) error(u8)
+#define TELEMETRY_FRAME_ERROR           0x05
+
+// host to device
+
+#define TELEMETRY_CMD_GET_COUNTERS      0x81
+// replies with the counters after they are cleared
+#define TELEMETRY_CMD_RESET_COUNTERS    0x82
+// param(u8), replies with TELEMETRY_FRAME_PARAM
+#define TELEMETRY_CMD_GET_PARAM         0x83
+// param(u8) value(u16), replies with TELEMETRY_FRAME_PARAM
+#define TELEMETRY_CMD_SET_PARAM         0x84
+
+#define TELEMETRY_ERROR_UNKNOWN_COMMAND 0x01
+#define TELEMETRY_ERROR_BAD_LENGTH      0x02
+#define TELEMETRY_ERROR_BAD_PARAM       0x03
+#define TELEMETRY_ERROR_BAD_VALUE       0x04
+
+// 0 or 1, send a TELEMETRY_FRAME_REPORT for every decoded report
+#define PARAM_STREAM_REPORTS            0x00
+// mouse motion scale in 1/16ths, 1-255
+#define PARAM_SENSITIVITY               0x01
+// ms between polls, 1-100, 0 uses the endpoint's bInterval
+#define PARAM_POLL_INTERVAL             0x02
+#define PARAM_COUNT                     3
+
+// all fields are little endian uint16_t so there is no padding on any side
+struct TelemetryCounters {
+  uint16_t polls;
+  uint16_t reports;
+  uint16_t naks;
+  uint16_t stalls;
+  uint16_t timeouts;
+  uint16_t toggleErrors;
+  uint16_t disconnects;
+  uint16_t errors;
+  uint16_t clearHalts;
+  uint16_t oversizeReports;
+  uint16_t undecodedReports;
+  uint16_t recoveries;
+  uint16_t failedRecoveries;
+  uint16_t lastRecoveryMs;
+  uint16_t maxRecoveryMs;
+  uint16_t enumerationMs;
+  uint16_t lastPollUs;
+  uint16_t maxPollUs;
+  uint16_t framesSent;
+  // frames that didn't fit in the tx ring
+  uint16_t framesDropped;
+  // frames from the host with a bad crc or encoding
+  uint16_t badFrames;
+  // bytes lost to a full rx ring or a uart overrun
+  uint16_t rxOverruns;
+  uint16_t stackFree;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "timebase.h"
+
+#include <Arduino.h>
+
+void timeInit() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    // the Arduino core sets Timer1 up for 8 bit pwm, use normal mode instead
+    TCCR1A = 0;
+    TCCR1B = (1 << CS11) | (1 << CS10);
+    TIMSK1 = 0;
+    TCNT1 = 0;
+  }
+}
+
+void timeDelay(uint16_t ticks) {
+  uint16_t start = timeNow();
+
+  while (timeElapsed(start) < ticks);
+}
+
+void timeDelayMs(uint16_t ms) {
+  // split up so each wait stays inside the counter range
+  while (ms > 100) {
+    timeDelay(TIME_MS(100));
+    ms -= 100;
+  }
+
+  timeDelay(TIME_MS(ms));
+}
+
+void periodicTaskInit(struct PeriodicTask* task, uint16_t period) {
+  task->period = period;
+  task->next = timeNow();
+}
+
+bool periodicTaskDue(struct PeriodicTask* task) {
+  uint16_t now = timeNow();
+  int16_t late = (int16_t)(now - task->next);
+
+  if (late < 0) {
+    return false;
+  }
+
+  if ((uint16_t)late >= task->period) {
+    task->next = now + task->period;
+  } else {
+    task->next += task->period;
+  }
+
+  return true;
+}
+
+void stopwatchStart(struct Stopwatch* stopwatch) {
+  stopwatch->lastTick = timeNow();
+  stopwatch->elapsedTicks = 0;
+}
+
+void stopwatchUpdate(struct Stopwatch* stopwatch) {
+  uint16_t now = timeNow();
+  stopwatch->elapsedTicks += (uint16_t)(now - stopwatch->lastTick);
+  stopwatch->lastTick = now;
+}
+
+uint16_t stopwatchMs(struct Stopwatch* stopwatch) {
+  stopwatchUpdate(stopwatch);
+
+  uint32_t ms = TIME_TICKS_TO_MS(stopwatch->elapsedTicks);
+
+  return ms > 0xFFFF ? 0xFFFF : (uint16_t)ms;
+}
@@ -0,0 +1,75 @@
+#ifndef __TIMEBASE_H__
+#define __TIMEBASE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+// Timer1 free runs at F_CPU / 64 with no interrupts so it never delays
+// the N64 line. One tick is 4us and the counter wraps every 262ms.
+#define TIME_TICKS_PER_MS   250
+#define TIME_MS(ms)         ((uint16_t)((ms) * TIME_TICKS_PER_MS))
+#define TIME_US(us)         ((uint16_t)((us) / 4))
+#define TIME_TICKS_TO_MS(ticks)   ((ticks) / TIME_TICKS_PER_MS)
+
+// deadlines have to be less than half the counter range away
+#define TIME_MAX_WAIT       0x7FFF
+
+struct PeriodicTask {
+  uint16_t next;
+  uint16_t period;
+};
+
+// times spans longer than the counter range, as long as it's updated
+// at least once every 262ms
+struct Stopwatch {
+  uint16_t lastTick;
+  uint32_t elapsedTicks;
+};
+
+void timeInit();
+
+// only call from an ISR or with interrupts off
+static inline uint16_t timeNowFromISR() {
+  return TCNT1;
+}
+
+// a 16 bit read shares the TEMP register with any ISR reading Timer1
+static inline uint16_t timeNow() {
+  uint16_t result;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    result = TCNT1;
+  }
+
+  return result;
+}
+
+static inline uint16_t timeElapsed(uint16_t since) {
+  return timeNow() - since;
+}
+
+static inline uint16_t timeDeadline(uint16_t ticks) {
+  return timeNow() + ticks;
+}
+
+static inline bool timeReached(uint16_t deadline) {
+  return (int16_t)(timeNow() - deadline) >= 0;
+}
+
+void timeDelay(uint16_t ticks);
+void timeDelayMs(uint16_t ms);
+
+void periodicTaskInit(struct PeriodicTask* task, uint16_t period);
+// returns true once per period, a task that falls more than a period
+// behind skips the missed runs instead of running back to back
+bool periodicTaskDue(struct PeriodicTask* task);
+
+void stopwatchStart(struct Stopwatch* stopwatch);
+void stopwatchUpdate(struct Stopwatch* stopwatch);
+// updates the stopwatch and returns the elapsed time, saturating at 0xFFFF
+uint16_t stopwatchMs(struct Stopwatch* stopwatch);
+
+#endif
@@ -0,0 +1,14 @@
+// just enough of the Arduino core and avr-libc to build the firmware's
+// telemetry on a PC, see telemetry_loopback.cpp
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <avr/io.h>
+
+#define F_CPU   16000000UL
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __HOST_AVR_INTERRUPT_H__
+#define __HOST_AVR_INTERRUPT_H__
+
+// interrupts are plain functions the host program calls itself
+#define ISR(vector)     extern "C" void vector(void)
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __HOST_UTIL_ATOMIC_H__
+#define __HOST_UTIL_ATOMIC_H__
+
+// the host program is single threaded and only runs an ISR between calls
+#define ATOMIC_RESTORESTATE     0
+#define ATOMIC_BLOCK(type)      for (int _atomicOnce = 1; _atomicOnce; _atomicOnce = 0)
+
+#endif
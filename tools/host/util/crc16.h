@@ -0,0 +1,13 @@
+#ifndef __HOST_UTIL_CRC16_H__
+#define __HOST_UTIL_CRC16_H__
+
+#include <stdint.h>
+
+// same as avr-libc's
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+    data ^= (uint8_t)crc;
+    data ^= data << 4;
+    return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+#endif
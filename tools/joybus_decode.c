@@ -0,0 +1,301 @@
+// decodes the sniffer's capture lines from joybus_sniffer.cpp and prints
+// the same session stats the firmware does
+//
+//   joybus_decode [-v] [capture.txt]
+//   joybus_decode -s [-n count] [-p period_us] [-j jitter_us] [-c command] [-r] > capture.txt
+//
+// -s writes a synthetic capture instead, -r leaves out the responses
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../joybus_decoder.h"
+
+#define MAX_EDGES           1024
+// a bit on the wire in 0.5us ticks
+#define SYNTH_BIT_TICKS     (4 * JOYBUS_TICKS_PER_US)
+#define SYNTH_ONE_TICKS     (1 * JOYBUS_TICKS_PER_US)
+#define SYNTH_ZERO_TICKS    (3 * JOYBUS_TICKS_PER_US)
+// console stop bit to the controller's first bit
+#define SYNTH_RESPONSE_DELAY_TICKS  (4 * JOYBUS_TICKS_PER_US)
+#define SYNTH_CONTROLLER_STOP_TICKS (2 * JOYBUS_TICKS_PER_US)
+
+struct Synth {
+    uint8_t edges[MAX_EDGES];
+    int count;
+};
+
+static void printStats(struct JoybusSessionStats* stats) {
+    printf("S n=%u period_us=%lu/%lu/%lu jitter_us=%lu idle_min_us=%lu busy_max_us=%u busy_pct=%u"
+        " cmd_00=%u cmd_01=%u cmd_02=%u cmd_03=%u cmd_ff=%u cmd_other=%u"
+        " no_resp=%u bad_resp=%u truncated=%u missed=%u\n",
+        stats->transactions,
+        (unsigned long)stats->minPeriodUs,
+        (unsigned long)joybusStatsAveragePeriodUs(stats),
+        (unsigned long)stats->maxPeriodUs,
+        (unsigned long)joybusStatsJitterUs(stats),
+        (unsigned long)stats->minIdleUs,
+        stats->maxBusyUs,
+        joybusStatsBusyPercent(stats),
+        stats->commands[JoybusCommandStatus],
+        stats->commands[JoybusCommandPoll],
+        stats->commands[JoybusCommandRead],
+        stats->commands[JoybusCommandWrite],
+        stats->commands[JoybusCommandReset],
+        stats->commands[JoybusCommandOther],
+        stats->noResponse,
+        stats->badResponse,
+        stats->truncated,
+        stats->missed
+    );
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+static void printTransaction(uint16_t start, struct JoybusTransaction* transaction, int truncated) {
+    printf("%04X cmd", start);
+
+    for (int i = 0; i < JOYBUS_KEEP_BYTES && i * 8 < transaction->commandBits; ++i) {
+        printf(" %02X", transaction->command[i]);
+    }
+
+    printf(" (%u bits) resp", transaction->commandBits);
+
+    for (int i = 0; i < JOYBUS_KEEP_BYTES && i * 8 < transaction->responseBits; ++i) {
+        printf(" %02X", transaction->response[i]);
+    }
+
+    printf(" (%u bits) delay %.1fus busy %uus%s\n",
+        transaction->responseBits,
+        transaction->responseDelayTicks / (double)JOYBUS_TICKS_PER_US,
+        transaction->durationTicks / JOYBUS_TICKS_PER_US,
+        truncated ? " truncated" : ""
+    );
+}
+
+// returns 0 if the line isn't a capture
+static int decodeLine(const char* line, struct JoybusSessionStats* stats, int verbose) {
+    int truncated = line[0] == 'T';
+    unsigned start;
+    int offset;
+
+    if (sscanf(line + 1, " %4x %n", &start, &offset) != 1) {
+        return 0;
+    }
+
+    struct JoybusTransaction transaction;
+    struct JoybusDecoder decoder;
+
+    joybusDecoderInit(&decoder, &transaction);
+
+    const char* edges = line + 1 + offset;
+
+    while (hexValue(edges[0]) >= 0 && hexValue(edges[1]) >= 0) {
+        joybusDecoderEdge(&decoder, (uint8_t)(hexValue(edges[0]) << 4 | hexValue(edges[1])));
+        edges += 2;
+    }
+
+    joybusDecoderFinish(&decoder);
+
+    if (verbose) {
+        printTransaction((uint16_t)start, &transaction, truncated);
+    }
+
+    joybusStatsAdd(stats, (uint16_t)start, &transaction, truncated);
+
+    if (stats->transactions >= JOYBUS_STATS_MAX_TRANSACTIONS) {
+        printStats(stats);
+        joybusStatsReset(stats);
+    }
+
+    return 1;
+}
+
+static int decode(FILE* input, int verbose) {
+    struct JoybusSessionStats stats;
+    char line[4096];
+
+    joybusStatsReset(&stats);
+
+    while (fgets(line, sizeof(line), input)) {
+        if (line[0] == 'E' || line[0] == 'T') {
+            decodeLine(line, &stats, verbose);
+        } else if (line[0] == 'S') {
+            // the firmware ended a session, print both to compare
+            if (stats.transactions) {
+                printStats(&stats);
+                joybusStatsReset(&stats);
+            }
+            printf("device %s", line);
+        }
+    }
+
+    if (stats.transactions) {
+        printStats(&stats);
+    }
+
+    return 0;
+}
+
+static void synthEdge(struct Synth* synth, int ticks) {
+    if (synth->count < MAX_EDGES) {
+        synth->edges[synth->count++] = (uint8_t)ticks;
+    }
+}
+
+// low then high for each bit, the high after the last bit is left to the caller
+static void synthBits(struct Synth* synth, const uint8_t* data, int bits) {
+    for (int i = 0; i < bits; ++i) {
+        int one = (data[i >> 3] >> (7 - (i & 7))) & 1;
+        int low = one ? SYNTH_ONE_TICKS : SYNTH_ZERO_TICKS;
+
+        synthEdge(synth, low);
+        synthEdge(synth, SYNTH_BIT_TICKS - low);
+    }
+}
+
+static void synthTransaction(struct Synth* synth, uint8_t command, int withResponse, unsigned sequence) {
+    uint8_t data[40];
+    int commandBits = joybusCommandBits(command);
+    int responseBits = joybusResponseBits(command);
+
+    synth->count = 0;
+
+    memset(data, 0, sizeof(data));
+    data[0] = command;
+    synthBits(synth, data, commandBits);
+
+    // console stop bit
+    synthEdge(synth, SYNTH_ONE_TICKS);
+
+    if (!withResponse || responseBits == 0) {
+        return;
+    }
+
+    synthEdge(synth, SYNTH_BIT_TICKS - SYNTH_ONE_TICKS + SYNTH_RESPONSE_DELAY_TICKS);
+
+    // buttons change with each poll so the responses aren't all the same
+    memset(data, 0, sizeof(data));
+    data[0] = (uint8_t)sequence;
+    data[1] = (uint8_t)(sequence >> 8);
+    data[2] = (uint8_t)(sequence * 3);
+    data[3] = (uint8_t)-(int)sequence;
+
+    synthBits(synth, data, responseBits);
+
+    // the last bit's high is part of the stop bit's low
+    --synth->count;
+    synthEdge(synth, SYNTH_CONTROLLER_STOP_TICKS);
+}
+
+static int synthesize(int count, unsigned periodUs, unsigned jitterUs, uint8_t command, int withResponse) {
+    struct Synth synth;
+    uint32_t timeUs = 0;
+
+    srand(1);
+
+    for (int i = 0; i < count; ++i) {
+        synthTransaction(&synth, command, withResponse, (unsigned)i);
+
+        // start is in the firmware's 4us timebase ticks
+        printf("E %04X ", (unsigned)((timeUs / 4) & 0xFFFF));
+
+        for (int e = 0; e < synth.count; ++e) {
+            printf("%02X", synth.edges[e]);
+        }
+
+        printf("\n");
+
+        int offset = jitterUs ? (int)(rand() % (2 * jitterUs + 1)) - (int)jitterUs : 0;
+        timeUs += periodUs + offset;
+    }
+
+    return 0;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [-v] [capture]\n"
+        "       %s -s [-n count] [-p period_us] [-j jitter_us] [-c command] [-r]\n",
+        program, program
+    );
+}
+
+int main(int argc, char** argv) {
+    int verbose = 0;
+    int synth = 0;
+    int count = 600;
+    unsigned periodUs = 16683;
+    unsigned jitterUs = 0;
+    uint8_t command = JOYBUS_CMD_POLL;
+    int withResponse = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "vsn:p:j:c:r")) != -1) {
+        switch (opt) {
+            case 'v':
+                verbose = 1;
+                break;
+            case 's':
+                synth = 1;
+                break;
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'p':
+                periodUs = (unsigned)strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                jitterUs = (unsigned)strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                command = (uint8_t)strtoul(optarg, NULL, 16);
+                break;
+            case 'r':
+                withResponse = 0;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (synth) {
+        return synthesize(count, periodUs, jitterUs, command, withResponse);
+    }
+
+    FILE* input = stdin;
+
+    if (optind < argc) {
+        input = fopen(argv[optind], "r");
+
+        if (!input) {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+
+    int result = decode(input, verbose);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+
+    return result;
+}
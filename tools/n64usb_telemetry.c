@@ -0,0 +1,472 @@
+// host side of the telemetry protocol in telemetry_protocol.h
+//
+//   n64usb_telemetry [-d device] counters
+//   n64usb_telemetry [-d device] reset
+//   n64usb_telemetry [-d device] get <param>
+//   n64usb_telemetry [-d device] set <param> <value>
+//   n64usb_telemetry [-d device] stream
+//   n64usb_telemetry [-d device] monitor
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../telemetry_protocol.h"
+#include "../messages.h"
+
+#define DEFAULT_DEVICE      "/dev/ttyUSB0"
+#define REPLY_TIMEOUT_MS    500
+// raising DTR resets the nano, wait for the bootloader to hand over
+#define BOOT_WAIT_MS        2000
+
+#define MESSAGE_TEXT(id, text) text,
+
+static const char* gMessageText[] = {
+    MESSAGE_LIST(MESSAGE_TEXT)
+};
+
+static const char* gParamNames[PARAM_COUNT] = {
+    "stream",
+    "sensitivity",
+    "poll-interval",
+};
+
+static volatile sig_atomic_t gStop;
+
+struct FrameReader {
+    uint8_t data[256];
+    size_t length;
+    int overflow;
+};
+
+static uint16_t crcUpdate(uint16_t crc, uint8_t data) {
+    // same as avr-libc's _crc_ccitt_update
+    data ^= (uint8_t)crc;
+    data ^= data << 4;
+    return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+static uint16_t crcFrame(const uint8_t* data, size_t length) {
+    uint16_t crc = TELEMETRY_CRC_INIT;
+
+    for (size_t i = 0; i < length; ++i) {
+        crc = crcUpdate(crc, data[i]);
+    }
+
+    return crc;
+}
+
+static size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* out) {
+    size_t codeIndex = 0;
+    size_t write = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+        } else {
+            out[write++] = data[i];
+
+            if (++code == 0xFF) {
+                out[codeIndex] = code;
+                codeIndex = write++;
+                code = 1;
+            }
+        }
+    }
+
+    out[codeIndex] = code;
+    out[write++] = 0;
+
+    return write;
+}
+
+static size_t cobsDecode(uint8_t* data, size_t length) {
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < length) {
+        uint8_t code = data[read++];
+
+        if (code == 0 || read + code - 1 > length) {
+            return 0;
+        }
+
+        for (uint8_t i = 1; i < code; ++i) {
+            data[write++] = data[read++];
+        }
+
+        if (code != 0xFF && read < length) {
+            data[write++] = 0;
+        }
+    }
+
+    return write;
+}
+
+static int openPort(const char* device) {
+    int fd = open(device, O_RDWR | O_NOCTTY);
+
+    if (fd < 0) {
+        fprintf(stderr, "could not open %s: %s\n", device, strerror(errno));
+        return -1;
+    }
+
+    struct termios tty;
+
+    if (tcgetattr(fd, &tty) != 0) {
+        fprintf(stderr, "%s is not a serial port\n", device);
+        close(fd);
+        return -1;
+    }
+
+    // the open raised DTR and reset the board, unless an earlier run
+    // cleared HUPCL and left DTR up when it closed the port
+    int didReset = (tty.c_cflag & HUPCL) != 0;
+
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B500000);
+    cfsetospeed(&tty, B500000);
+    tty.c_cflag |= CLOCAL | CREAD;
+    // keep DTR up on close so the next run doesn't reset the board and
+    // lose the counters and settings
+    tty.c_cflag &= ~HUPCL;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        fprintf(stderr, "could not configure %s: %s\n", device, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (didReset) {
+        usleep(BOOT_WAIT_MS * 1000);
+    }
+
+    tcflush(fd, TCIOFLUSH);
+
+    return fd;
+}
+
+static int sendCommand(int fd, uint8_t command, const uint8_t* payload, size_t length) {
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    uint8_t encoded[TELEMETRY_ENCODED_SIZE(TELEMETRY_MAX_FRAME)];
+
+    frame[0] = command;
+    memcpy(frame + 1, payload, length);
+
+    uint16_t crc = crcFrame(frame, length + 1);
+    frame[length + 1] = (uint8_t)crc;
+    frame[length + 2] = (uint8_t)(crc >> 8);
+
+    size_t encodedLength = cobsEncode(frame, length + 3, encoded);
+
+    return write(fd, encoded, encodedLength) == (ssize_t)encodedLength ? 0 : -1;
+}
+
+// returns the frame length, 0 on timeout and -1 on error
+static int readFrame(int fd, struct FrameReader* reader, uint8_t* frame, int timeoutMs) {
+    for (;;) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, timeoutMs);
+
+        if (ready < 0) {
+            return errno == EINTR ? 0 : -1;
+        }
+
+        if (ready == 0) {
+            return 0;
+        }
+
+        uint8_t next;
+
+        if (read(fd, &next, 1) != 1) {
+            return -1;
+        }
+
+        if (next != 0) {
+            if (reader->length < sizeof(reader->data)) {
+                reader->data[reader->length++] = next;
+            } else {
+                reader->overflow = 1;
+            }
+            continue;
+        }
+
+        size_t length = reader->overflow ? 0 : cobsDecode(reader->data, reader->length);
+        reader->length = 0;
+        reader->overflow = 0;
+
+        if (length < 3 || crcFrame(reader->data, length - 2) != (reader->data[length - 2] | (reader->data[length - 1] << 8))) {
+            fprintf(stderr, "bad frame\n");
+            continue;
+        }
+
+        memcpy(frame, reader->data, length - 2);
+
+        return (int)(length - 2);
+    }
+}
+
+static uint16_t readWord(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static void printCounters(const uint8_t* payload, int length) {
+    struct TelemetryCounters counters;
+
+    if (length != sizeof(counters)) {
+        fprintf(stderr, "counters frame is %d bytes, expected %zu\n", length, sizeof(counters));
+        return;
+    }
+
+    // the struct is all uint16_t, little endian on both sides
+    memcpy(&counters, payload, sizeof(counters));
+
+    printf("polls              %u\n", counters.polls);
+    printf("reports            %u\n", counters.reports);
+    printf("naks               %u\n", counters.naks);
+    printf("stalls             %u\n", counters.stalls);
+    printf("timeouts           %u\n", counters.timeouts);
+    printf("toggle errors      %u\n", counters.toggleErrors);
+    printf("disconnects        %u\n", counters.disconnects);
+    printf("errors             %u\n", counters.errors);
+    printf("clear halts        %u\n", counters.clearHalts);
+    printf("oversize reports   %u\n", counters.oversizeReports);
+    printf("undecoded reports  %u\n", counters.undecodedReports);
+    printf("recoveries         %u\n", counters.recoveries);
+    printf("failed recoveries  %u\n", counters.failedRecoveries);
+    printf("last recovery      %u ms\n", counters.lastRecoveryMs);
+    printf("max recovery       %u ms\n", counters.maxRecoveryMs);
+    printf("enumeration        %u ms\n", counters.enumerationMs);
+    printf("last poll          %u us\n", counters.lastPollUs);
+    printf("max poll           %u us\n", counters.maxPollUs);
+    printf("frames sent        %u\n", counters.framesSent);
+    printf("frames dropped     %u\n", counters.framesDropped);
+    printf("bad frames         %u\n", counters.badFrames);
+    printf("rx overruns        %u\n", counters.rxOverruns);
+    printf("stack free         %u\n", counters.stackFree);
+}
+
+static void printLog(const uint8_t* payload, int length) {
+    if (length < 1) {
+        return;
+    }
+
+    const char* text = payload[0] < MessageCount ? gMessageText[payload[0]] : "unknown message ";
+    size_t textLength = strlen(text);
+
+    // the firmware's strings carry their own newline when they have no value
+    if (length > 2) {
+        printf("log: %s%04X\n", text, readWord(payload + 1));
+    } else if (length > 1) {
+        printf("log: %s%02X\n", text, payload[1]);
+    } else if (textLength && text[textLength - 1] == '\n') {
+        printf("log: %s", text);
+    } else {
+        printf("log: %s\n", text);
+    }
+}
+
+static void printReport(const uint8_t* payload, int length) {
+    if (length != 7) {
+        return;
+    }
+
+    printf("%5u %s buttons %04X x %4d y %4d\n",
+        readWord(payload),
+        payload[2] ? "gamepad" : "mouse",
+        readWord(payload + 3),
+        (int8_t)payload[5],
+        (int8_t)payload[6]
+    );
+}
+
+// prints a frame, returns 1 if it was a reply to a command
+static int handleFrame(const uint8_t* frame, int length) {
+    const uint8_t* payload = frame + 1;
+    int payloadLength = length - 1;
+
+    switch (frame[0]) {
+        case TELEMETRY_FRAME_COUNTERS:
+            printCounters(payload, payloadLength);
+            return 1;
+        case TELEMETRY_FRAME_PARAM:
+            if (payloadLength == 3) {
+                printf("%s = %u\n", payload[0] < PARAM_COUNT ? gParamNames[payload[0]] : "?", readWord(payload + 1));
+            }
+            return 1;
+        case TELEMETRY_FRAME_ERROR:
+            if (payloadLength == 2) {
+                printf("command %02X failed with error %u\n", payload[0], payload[1]);
+            }
+            return 1;
+        case TELEMETRY_FRAME_LOG:
+            printLog(payload, payloadLength);
+            return 0;
+        case TELEMETRY_FRAME_REPORT:
+            printReport(payload, payloadLength);
+            return 0;
+    }
+
+    printf("unknown frame type %02X\n", frame[0]);
+
+    return 0;
+}
+
+static int waitForReply(int fd, struct FrameReader* reader) {
+    uint8_t frame[256];
+
+    for (;;) {
+        int length = readFrame(fd, reader, frame, REPLY_TIMEOUT_MS);
+
+        if (length <= 0) {
+            fprintf(stderr, "no reply\n");
+            return -1;
+        }
+
+        if (handleFrame(frame, length)) {
+            return frame[0] == TELEMETRY_FRAME_ERROR ? -1 : 0;
+        }
+    }
+}
+
+static int findParam(const char* name) {
+    for (int i = 0; i < PARAM_COUNT; ++i) {
+        if (strcmp(name, gParamNames[i]) == 0) {
+            return i;
+        }
+    }
+
+    fprintf(stderr, "unknown param %s, expected stream, sensitivity or poll-interval\n", name);
+
+    return -1;
+}
+
+static void stopSignal(int signal) {
+    (void)signal;
+    gStop = 1;
+}
+
+static int monitor(int fd, struct FrameReader* reader) {
+    uint8_t frame[256];
+
+    signal(SIGINT, stopSignal);
+
+    while (!gStop) {
+        int length = readFrame(fd, reader, frame, REPLY_TIMEOUT_MS);
+
+        if (length < 0) {
+            return -1;
+        }
+
+        if (length > 0) {
+            handleFrame(frame, length);
+            fflush(stdout);
+        }
+    }
+
+    return 0;
+}
+
+static int setParam(int fd, struct FrameReader* reader, uint8_t param, uint16_t value) {
+    uint8_t payload[3] = { param, (uint8_t)value, (uint8_t)(value >> 8) };
+
+    if (sendCommand(fd, TELEMETRY_CMD_SET_PARAM, payload, sizeof(payload)) != 0) {
+        return -1;
+    }
+
+    return waitForReply(fd, reader);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [-d device] counters|reset|monitor|stream\n"
+        "       %s [-d device] get <param>\n"
+        "       %s [-d device] set <param> <value>\n"
+        "params: stream, sensitivity (16 is 1:1), poll-interval (ms, 0 uses bInterval)\n",
+        program, program, program
+    );
+}
+
+int main(int argc, char** argv) {
+    const char* device = DEFAULT_DEVICE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:")) != -1) {
+        if (opt == 'd') {
+            device = optarg;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const char* command = argv[optind];
+    int argCount = argc - optind - 1;
+    char** args = argv + optind + 1;
+
+    int fd = openPort(device);
+
+    if (fd < 0) {
+        return 1;
+    }
+
+    struct FrameReader reader = { { 0 }, 0, 0 };
+    int result = -1;
+
+    if (strcmp(command, "counters") == 0) {
+        if (sendCommand(fd, TELEMETRY_CMD_GET_COUNTERS, NULL, 0) == 0) {
+            result = waitForReply(fd, &reader);
+        }
+    } else if (strcmp(command, "reset") == 0) {
+        if (sendCommand(fd, TELEMETRY_CMD_RESET_COUNTERS, NULL, 0) == 0) {
+            result = waitForReply(fd, &reader);
+        }
+    } else if (strcmp(command, "get") == 0 && argCount == 1) {
+        int param = findParam(args[0]);
+
+        if (param >= 0) {
+            uint8_t payload[1] = { (uint8_t)param };
+
+            if (sendCommand(fd, TELEMETRY_CMD_GET_PARAM, payload, sizeof(payload)) == 0) {
+                result = waitForReply(fd, &reader);
+            }
+        }
+    } else if (strcmp(command, "set") == 0 && argCount == 2) {
+        int param = findParam(args[0]);
+
+        if (param >= 0) {
+            result = setParam(fd, &reader, (uint8_t)param, (uint16_t)strtoul(args[1], NULL, 0));
+        }
+    } else if (strcmp(command, "stream") == 0) {
+        if (setParam(fd, &reader, PARAM_STREAM_REPORTS, 1) == 0) {
+            result = monitor(fd, &reader);
+            setParam(fd, &reader, PARAM_STREAM_REPORTS, 0);
+        }
+    } else if (strcmp(command, "monitor") == 0) {
+        result = monitor(fd, &reader);
+    } else {
+        usage(argv[0]);
+        close(fd);
+        return 2;
+    }
+
+    close(fd);
+
+    return result == 0 ? 0 : 1;
+}
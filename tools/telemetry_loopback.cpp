@@ -0,0 +1,114 @@
+// runs the firmware's telemetry.cpp on a PC behind a pseudo terminal so
+// n64usb_telemetry can be tested without a board
+//
+//   telemetry_loopback
+//
+// prints the pty to point n64usb_telemetry -d at, then serves it until
+// killed. The poll stats are fixed values, streaming sends a made up
+// report and two log frames every 100ms. telemetry_pty_test.sh drives it.
+
+#include <poll.h>
+#include <pty.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../telemetry.h"
+#include "../usb_hid.h"
+#include "../runtime_params.h"
+#include "../messages.h"
+#include "../stack_monitor.h"
+
+#define STREAM_PERIOD_MS    100
+
+volatile uint8_t UCSR0A;
+volatile uint8_t UCSR0B;
+volatile uint8_t UCSR0C;
+volatile uint8_t UDR0;
+volatile uint16_t UBRR0;
+volatile uint16_t TCNT1;
+
+extern "C" void USART_UDRE_vect(void);
+extern "C" void USART_RX_vect(void);
+
+static struct UsbPollStats gStats;
+
+struct UsbPollStats* usbGetPollStats() {
+    return &gStats;
+}
+
+void usbResetPollStats() {
+    memset(&gStats, 0, sizeof(gStats));
+}
+
+uint16_t stackUnusedBytes() {
+    return 321;
+}
+
+static uint32_t nowMs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+int main() {
+    int master;
+    int slave;
+    char name[64];
+
+    if (openpty(&master, &slave, name, NULL, NULL) != 0) {
+        perror("openpty");
+        return 1;
+    }
+
+    printf("%s\n", name);
+    fflush(stdout);
+
+    gStats.polls = 1234;
+    gStats.results[UsbPollResultNak] = 77;
+    gStats.enumerationMs = 180;
+
+    telemetryInit();
+
+    uint32_t nextReport = nowMs();
+    int8_t x = 0;
+
+    for (;;) {
+        struct pollfd pfd = { master, POLLIN, 0 };
+
+        if (poll(&pfd, 1, 1) > 0) {
+            uint8_t next;
+
+            if (read(master, &next, 1) == 1) {
+                UDR0 = next;
+                USART_RX_vect();
+            }
+        }
+
+        // Timer1 runs at 4us a tick
+        TCNT1 = (uint16_t)(nowMs() * 250);
+
+        telemetryUpdate();
+
+        // the UDRE interrupt fires as long as it's enabled
+        while (UCSR0B & (1 << UDRIE0)) {
+            USART_UDRE_vect();
+
+            if (UCSR0B & (1 << UDRIE0)) {
+                uint8_t sent = UDR0;
+                write(master, &sent, 1);
+            }
+        }
+
+        if (runtimeParams()->streamReports && (int32_t)(nowMs() - nextReport) >= 0) {
+            struct N64ControllerState state = { 0x8000, x++, -3 };
+            uint8_t status = 0x14;
+
+            telemetrySendReport(HID_DEVICE_TYPE_MOUSE, &state);
+            printMessageHex(MessageStatus, status);
+            printMessageWord(MessageStackFree, stackUnusedBytes());
+
+            nextReport += STREAM_PERIOD_MS;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#!/bin/bash
+# runs n64usb_telemetry against the firmware's telemetry.cpp served by
+# telemetry_loopback and checks the replies
+#   make -C tools pty-test
+cd "$(dirname "$0")"
+
+failed=0
+
+check() {
+  local name=$1
+  local expected=$2
+  local output=$3
+
+  if grep -q -- "$expected" <<< "$output"; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name, expected \"$expected\" in:"
+    echo "$output"
+    failed=1
+  fi
+}
+
+coproc LOOPBACK { exec ./telemetry_loopback; }
+trap 'kill $LOOPBACK_PID 2>/dev/null' EXIT
+read -r PTY <&"${LOOPBACK[0]}"
+
+# a real serial port starts out dropping DTR on close
+stty -F "$PTY" hupcl
+
+# the first run waits for the board to boot and clears HUPCL
+output=$(./n64usb_telemetry -d "$PTY" counters 2>&1)
+check "counters" "polls              1234" "$output"
+check "counters stack" "stack free         321" "$output"
+check "hupcl cleared" "-hupcl" "$(stty -F "$PTY" -a)"
+
+output=$(./n64usb_telemetry -d "$PTY" set sensitivity 24 2>&1)
+check "set" "sensitivity = 24" "$output"
+
+# a later run mustn't reset the board, so the setting is still there and
+# there is no boot wait
+start=$(date +%s%N)
+output=$(./n64usb_telemetry -d "$PTY" get sensitivity 2>&1)
+elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+check "setting kept" "sensitivity = 24" "$output"
+check "no boot wait" "fast" "$([ $elapsed -lt 1000 ] && echo fast || echo "took ${elapsed}ms")"
+
+output=$(./n64usb_telemetry -d "$PTY" set poll-interval 200 2>&1)
+check "bad value" "failed with error" "$output"
+
+output=$(./n64usb_telemetry -d "$PTY" reset 2>&1; ./n64usb_telemetry -d "$PTY" counters 2>&1)
+check "reset" "polls              0" "$output"
+
+output=$(timeout -s INT 1 ./n64usb_telemetry -d "$PTY" stream 2>&1)
+check "stream reports" "mouse buttons 8000" "$output"
+check "stream logs" "log: GET_STATUS: 0x14" "$output"
+check "stream word logs" "log: Stack free: 0x0141" "$output"
+
+output=$(./n64usb_telemetry -d "$PTY" get stream 2>&1)
+check "stream off" "stream = 0" "$output"
+
+exit $failed
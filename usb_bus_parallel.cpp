@@ -0,0 +1,97 @@
+#include "usb_transfer.h"
+
+#if USB_TRANSPORT == USB_TRANSPORT_PARALLEL
+
+#include <Arduino.h>
+
+void usbBusInit() {
+  pinMode(4, INPUT); // USB-RD
+  pinMode(5, INPUT); // USB-WR
+  pinMode(6, INPUT); // USB-A0
+
+  pinMode(8, INPUT); // USB-D0
+  pinMode(9, INPUT); // USB-D1
+  pinMode(10, INPUT); // USB-D2
+  pinMode(11, INPUT); // USB-D3
+  pinMode(12, INPUT); // USB-D4
+
+  pinMode(A0, INPUT); // USB-D5
+  pinMode(A1, INPUT); // USB-D6
+  pinMode(A2, INPUT); // USB-D7
+}
+
+void usbBusSetSpeed() {
+  // the parallel bus has no rate to set
+}
+
+void usbWriteByte(uint8_t byte, bool isData) {
+  // needed to space commands out
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+
+  if (isData) {
+    // send data
+    DDRD |= USB_A0;
+  } else {
+    // send command
+    DDRD &= ~USB_A0;
+  }
+
+  // configure the output pins 
+  DDRC = ((~byte & 0xE0) >> 5) | (DDRC & 0xF8);
+  // DDRC |= 0x07;
+  DDRB = (~byte) & 0x1F;
+
+  // trigger write
+  DDRD |= USB_WR;
+  DDRD &= ~USB_WR;
+  // needed to allow USB chip to finish reading
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+
+  DDRB = 0x00;
+  DDRC &= 0xF8;
+}
+
+uint8_t usbReadByte() {
+  // needed to space commands out
+  delayMicroseconds(3);
+
+  // configure the data line to be input pins and configure USB_A0 to read
+  DDRD |= USB_A0;
+
+  DDRB = 0x00;
+  DDRC &= 0xF8;
+
+  // trigger read
+  DDRD |= USB_RD;
+  // needed to let inputs stabilize
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+  asm volatile ("nop");
+
+  // read data
+  uint8_t result = (PINB & 0x1F) | ((PINC & 0x07) << 5);
+
+  // turn off read signal
+  DDRD &= ~USB_RD;
+
+  return result;
+}
+
+#endif
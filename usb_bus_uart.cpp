@@ -0,0 +1,161 @@
+#include "usb_transfer.h"
+
+#if USB_TRANSPORT == USB_TRANSPORT_UART
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "timebase.h"
+
+// sizes must be powers of 2
+#define USB_UART_TX_SIZE    16
+#define USB_UART_RX_SIZE    16
+
+// the 9th bit marks a command byte
+#define USB_UART_COMMAND    0x100
+
+// a reply can be queued behind a full tx ring at 9600 baud
+#define USB_UART_READ_TIMEOUT   TIME_MS(25)
+// RESET_ALL takes the CH375B about 35ms
+#define USB_UART_RESET_TIME_MS  40
+
+volatile uint16_t gUsbTxRing[USB_UART_TX_SIZE];
+volatile uint8_t gUsbTxHead;
+volatile uint8_t gUsbTxTail;
+
+volatile uint8_t gUsbRxRing[USB_UART_RX_SIZE];
+volatile uint8_t gUsbRxHead;
+volatile uint8_t gUsbRxTail;
+
+ISR(USART_UDRE_vect) {
+  if (gUsbTxHead == gUsbTxTail) {
+    // nothing left to send
+    UCSR0B &= ~(1 << UDRIE0);
+    return;
+  }
+
+  uint16_t next = gUsbTxRing[gUsbTxTail];
+  gUsbTxTail = (gUsbTxTail + 1) & (USB_UART_TX_SIZE - 1);
+
+  // the 9th bit has to be set before writing the low 8 bits
+  if (next & USB_UART_COMMAND) {
+    UCSR0B |= (1 << TXB80);
+  } else {
+    UCSR0B &= ~(1 << TXB80);
+  }
+
+  // TXC0 is set again once this byte has left the shift register, U2X0
+  // is the only other bit in use
+  UCSR0A = (1 << U2X0) | (1 << TXC0);
+  UDR0 = (uint8_t)next;
+}
+
+ISR(USART_RX_vect) {
+  uint8_t next = UDR0;
+  uint8_t head = (gUsbRxHead + 1) & (USB_UART_RX_SIZE - 1);
+
+  // replies are read before the next command is sent, so the ring only
+  // fills if a reply is ignored, the newest bytes are dropped
+  if (head == gUsbRxTail) {
+    return;
+  }
+
+  gUsbRxRing[gUsbRxHead] = next;
+  gUsbRxHead = head;
+}
+
+// waits for every queued byte to finish sending
+void usbUartDrain() {
+  uint16_t deadline = timeDeadline(USB_UART_READ_TIMEOUT);
+
+  while (gUsbTxHead != gUsbTxTail || !(UCSR0A & (1 << TXC0))) {
+    if (timeReached(deadline)) {
+      return;
+    }
+  }
+}
+
+void usbUartSetBaud(uint32_t baud) {
+  usbUartDrain();
+  UBRR0 = (F_CPU / 8 / baud) - 1;
+  // anything received during the switch is garbage
+  gUsbRxTail = gUsbRxHead;
+}
+
+void usbBusInit() {
+  // the CH375B keeps the faster rate when only the ATmega resets, so it
+  // gets a reset at that rate before usbUnit sends one at the reset rate
+  uint16_t ubrr = (F_CPU / 8 / USB_UART_BAUD) - 1;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    gUsbTxHead = 0;
+    gUsbTxTail = 0;
+    gUsbRxHead = 0;
+    gUsbRxTail = 0;
+
+    UBRR0 = ubrr;
+    UCSR0A = (1 << U2X0);
+    // 9 data bits, no parity, 1 stop bit
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UCSR0B = (1 << RXEN0) | (1 << TXEN0) | (1 << RXCIE0) | (1 << UCSZ02);
+  }
+
+  usbWriteByte(RESET_ALL, false);
+  usbUartSetBaud(USB_UART_RESET_BAUD);
+  timeDelayMs(USB_UART_RESET_TIME_MS);
+}
+
+void usbBusSetSpeed() {
+  usbWriteByte(SET_BAUDRATE, false);
+  usbWriteByte(USB_UART_BAUD_COEFF, true);
+  usbWriteByte(USB_UART_BAUD_CONST, true);
+
+  // the status comes back at the new rate
+  usbUartSetBaud(USB_UART_BAUD);
+
+  if (usbReadByte() != CMD_RET_SUCCESS) {
+    // the CH375B didn't take it, stay at the reset rate
+    usbUartSetBaud(USB_UART_RESET_BAUD);
+  }
+}
+
+void usbWriteByte(uint8_t byte, bool isData) {
+  uint16_t entry = isData ? byte : (byte | USB_UART_COMMAND);
+
+  if (!isData) {
+    // anything left over belongs to an earlier command
+    gUsbRxTail = gUsbRxHead;
+  }
+
+  uint8_t head = (gUsbTxHead + 1) & (USB_UART_TX_SIZE - 1);
+
+  // only waits if more than a ring of bytes is queued at once
+  while (head == gUsbTxTail);
+
+  gUsbTxRing[gUsbTxHead] = entry;
+  gUsbTxHead = head;
+
+  // the UDRE interrupt changes TXB80 in the same register
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    UCSR0B |= (1 << UDRIE0);
+  }
+}
+
+uint8_t usbReadByte() {
+  uint16_t deadline = timeDeadline(USB_UART_READ_TIMEOUT);
+
+  // the reply comes after any queued bytes are sent
+  while (gUsbRxHead == gUsbRxTail) {
+    if (timeReached(deadline)) {
+      return 0xFF;
+    }
+  }
+
+  uint8_t result = gUsbRxRing[gUsbRxTail];
+  gUsbRxTail = (gUsbRxTail + 1) & (USB_UART_RX_SIZE - 1);
+
+  return result;
+}
+
+#endif
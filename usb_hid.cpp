@@ -1,37 +1,27 @@
 
 #include <Arduino.h>
+#include <string.h>
 
 #include "usb_hid.h"
 #include "usb_transfer.h"
 #include "descriptor_parser.h"
+#include "report_parser.h"
+#include "report_decoder.h"
+#include "rumble.h"
+#include "gamepad.h"
 #include "debug_print.h"
-
-void delayNoTimer(int ms) {
-  while (ms) {
-    delayMicroseconds(1000);
-    --ms;
-  }
-}
+#include "messages.h"
+#include "stack_monitor.h"
 
 uint8_t usbUnit() {
   pinMode(3, INPUT); // USB-INT
 
-  pinMode(4, INPUT); // USB-RD
-  pinMode(5, INPUT); // USB-WR
-  pinMode(6, INPUT); // USB-A0
-
-  pinMode(8, INPUT); // USB-D0
-  pinMode(9, INPUT); // USB-D1
-  pinMode(10, INPUT); // USB-D2
-  pinMode(11, INPUT); // USB-D3
-  pinMode(12, INPUT); // USB-D4
-
-  pinMode(A0, INPUT); // USB-D5
-  pinMode(A1, INPUT); // USB-D6
-  pinMode(A2, INPUT); // USB-D7
+  usbBusInit();
 
   usbWriteByte(RESET_ALL, false);
-  delayNoTimer(40);
+  timeDelayMs(USB_RESET_TIME_MS);
+
+  usbBusSetSpeed();
 
   usbWriteByte(GET_IC_VER, false);
   uint8_t version = usbReadByte();
@@ -49,84 +39,242 @@ uint8_t gNextAddress = 1;
 uint8_t findNextUSBAddress() {
   uint8_t result = gNextAddress;
   ++gNextAddress;
+
+  // re-enumeration keeps asking for addresses, only 1-127 are valid
+  if (gNextAddress > 127) {
+    gNextAddress = 1;
+  }
+
   return result;
 }
 
+typedef bool (*EnumerationStep)(struct HidInfo* hidInfo);
+
+// updated between enumeration steps, each one is well under the timer range
+struct Stopwatch gEnumerationTime;
+// time since polls started failing, a recovery enumerates the device
+// again so it's updated along with gEnumerationTime
+struct Stopwatch gRecoveryTime;
+
+void enumerationTimeUpdate() {
+  stopwatchUpdate(&gEnumerationTime);
+  stopwatchUpdate(&gRecoveryTime);
+}
+
+// runs a step of the enumeration, giving it as many attempts as the
+// device's quirk asks for
+bool runEnumerationStep(struct HidInfo* hidInfo, EnumerationStep step) {
+  uint8_t attempts = hidInfo->quirk.retries;
+
+  while (!step(hidInfo)) {
+    enumerationTimeUpdate();
+
+    if (attempts == 0) {
+      return false;
+    }
+
+    --attempts;
+    timeDelayMs(QUIRK_RETRY_DELAY_MS);
+  }
+
+  enumerationTimeUpdate();
+
+  return true;
+}
+
+bool setDeviceConfiguration(struct HidInfo* hidInfo) {
+  return writeControlTransfer(0, REQUEST_TYPE_STANDARD | REQUEST_RECIPIENT_DEVICE, SET_CONFIGURATION, hidInfo->bootMouseConfiguration, 0, 0, NULL);
+}
+
+bool setDeviceProtocol(struct HidInfo* hidInfo) {
+  uint8_t protocol = SET_PROTOCOL_BOOT;
+
+  if (hidInfo->quirk.flags & QUIRK_FORCE_PROTOCOL) {
+    protocol = hidInfo->quirk.protocol;
+  }
+
+  return writeControlTransfer(0, REQUEST_TYPE_CLASS | REQUEST_RECIPIENT_INTERFACE, SET_PROTOCOL, protocol, hidInfo->bootMouseInterface, 0, NULL);
+}
+
 bool setupConnectedUSBDevice(struct HidInfo* hidInfo) {
 #if DEBUG
-  Serial.print("Setting target address to 0\n");
+  printMessage(MessageAddressZero);
 #endif
   usbWriteByte(SET_USB_ADDR, false);
   usbWriteByte(0x00, true);
 
+  // the device descriptor is read before the device is addressed so any
+  // quirks can be applied to the rest of the enumeration
+  if (!getDeviceInfo(hidInfo)) {
+    printMessage(MessageNoDevice);
+    return false;
+  }
+
+#if DEBUG
+  printMessage(MessageDeviceId);
+  printHex(hidInfo->idVendor >> 8);
+  printHex(hidInfo->idVendor);
+  printMessage(MessageSeparator);
+  printHex(hidInfo->idProduct >> 8);
+  printHex(hidInfo->idProduct);
+  printMessage(MessageNewline);
+#endif
+
+  if (quirkLookup(hidInfo->idVendor, hidInfo->idProduct, &hidInfo->quirk)) {
+    printMessageHex(MessageQuirkFlags, hidInfo->quirk.flags);
+  }
+
+  if (!isSupportedDeviceClass(hidInfo)) {
+    printMessageHex(MessageUnsupportedClass, hidInfo->deviceClass);
+    return false;
+  }
+
   uint8_t address = findNextUSBAddress();
 #if DEBUG
-  Serial.print("Configuring target to have address ");
-  Serial.print(address);
-  Serial.print("\n");
+  printMessageHex(MessageSettingAddress, address);
 #endif
   usbWriteByte(SET_ADDRESS, false);
   usbWriteByte(address, true);
 
   if (waitForInterrupt() != USB_INT_SUCCESS) {
 #if DEBUG
-    Serial.print("Failed to configure device address\n");
+    printMessage(MessageAddressFailed);
 #endif
     return false;
   }
 
+  enumerationTimeUpdate();
+
+  if (hidInfo->quirk.settleMs) {
+    timeDelayMs(hidInfo->quirk.settleMs);
+    enumerationTimeUpdate();
+  }
+
 #if DEBUG
-  Serial.print("Configured device address\n");
-  Serial.print("Getting boot mouse\n");
+  printMessage(MessageAddressConfigured);
+  printMessage(MessageGettingDevice);
 #endif
 
   usbWriteByte(SET_USB_ADDR, false);
   usbWriteByte(address, true);
 
-  if (!getHIDInfo(hidInfo)) {
-    Serial.print("Could not find boot mouse ");
-    return false;
-  }
+  bool configured = false;
+  bool isGamepad;
+
+  // composite devices can have several hid interfaces, the first one that
+  // can be used wins
+  for (hidInfo->interfaceSkip = 0;; ++hidInfo->interfaceSkip) {
+    if (!runEnumerationStep(hidInfo, getHIDInfo)) {
+      printMessage(MessageNoDevice);
+      return false;
+    }
+
+    if (hidInfo->quirk.flags & QUIRK_FORCE_ENDPOINT) {
+      hidInfo->bootMouseEndpoint = hidInfo->quirk.endpoint;
+    }
 
 #if DEBUG
-  Serial.print("Found boot mouse at ");
-  printHex(hidInfo->bootMouseConfiguration);
-  Serial.print(", ");
-  printHex(hidInfo->bootMouseInterface);
-  Serial.print(", ");
-  printHex(hidInfo->bootMouseEndpoint);
-  Serial.print("\n");
+    printMessage(MessageFoundDevice);
+    printHex(hidInfo->bootMouseConfiguration);
+    printMessage(MessageSeparator);
+    printHex(hidInfo->bootMouseInterface);
+    printMessage(MessageSeparator);
+    printHex(hidInfo->bootMouseEndpoint);
+    printMessage(MessageNewline);
 #endif
 
-  if (!writeControlTransfer(0, REQUEST_TYPE_STANDARD | REQUEST_RECIPIENT_DEVICE, SET_CONFIGURATION, hidInfo->bootMouseConfiguration, 0, 0, NULL)) {
-    Serial.print("Could not set configuration\n");
-    return false;
+    // every interface is in the one configuration
+    if (!configured) {
+      if (!runEnumerationStep(hidInfo, setDeviceConfiguration)) {
+        printMessage(MessageSetConfigFailed);
+        return false;
+      }
+
+      configured = true;
+    }
+
+    bool hasReportInfo = false;
+
+    if (hidInfo->quirk.flags & QUIRK_SKIP_REPORT_DESC) {
+      hidInfo->reportDescriptorLength = 0;
+      reportLayoutClear(&hidInfo->layout);
+    } else {
+      hasReportInfo = runEnumerationStep(hidInfo, getHIDReportInfo);
+    }
+
+    if (!hasReportInfo) {
+      // not fatal for a mouse, it just won't get output reports
+#if DEBUG
+      printMessage(MessageReportDescFailed);
+#endif
+      hidInfo->outputReportLength = 0;
+    }
+
+    isGamepad = hidInfo->deviceType == HID_DEVICE_TYPE_GAMEPAD;
+
+    if (!isGamepad || (hasReportInfo && gamepadInit(hidInfo))) {
+      break;
+    }
+
+    // not a joystick or gamepad, try the next interface
+    printMessage(MessageUnsupportedGamepad);
   }
 
-  if (!writeControlTransfer(0, REQUEST_TYPE_CLASS | REQUEST_RECIPIENT_INTERFACE, SET_PROTOCOL, SET_PROTOCOL_BOOT, hidInfo->bootMouseInterface, 0, NULL)) {
-    Serial.print("Could not set protocol\n");
+  bool forceProtocol = hidInfo->quirk.flags & QUIRK_FORCE_PROTOCOL;
+  // gamepads stay in report protocol unless a quirk says otherwise
+  bool sendProtocol = !(hidInfo->quirk.flags & QUIRK_SKIP_SET_PROTOCOL) && (!isGamepad || forceProtocol);
+
+  if (sendProtocol && !runEnumerationStep(hidInfo, setDeviceProtocol)) {
+    printMessage(MessageSetProtocolFailed);
     return false;
   }
 
+  if (!isGamepad) {
+    bool bootProtocol = sendProtocol && (!forceProtocol || hidInfo->quirk.protocol == SET_PROTOCOL_BOOT);
+
+    // a mouse left in report protocol is read with the layout from its
+    // report descriptor if it has one
+    if (bootProtocol || !reportLayoutHasField(&hidInfo->layout, ReportFieldX)) {
+      reportLayoutBootMouse(&hidInfo->layout);
+    }
+  }
+
+  reportDecoderInit(hidInfo);
+
   return true;
 }
 
+bool gOddPollParity = false;
+
+struct UsbPollStats gPollStats;
+
+struct RecoveryState {
+  uint8_t failureStreak;
+  uint8_t attempts;
+  bool waiting;
+  uint16_t retryAt;
+  uint16_t backoff;
+};
+
+struct RecoveryState gRecovery;
+
 bool handleConnect(struct HidInfo* hidInfo) {
+  stopwatchStart(&gEnumerationTime);
+
   setUSBMode(USBModeReset);
-  delayNoTimer(40);
+  timeDelayMs(USB_RESET_TIME_MS);
   setUSBMode(USBModeActive);
 
   uint8_t resetResult = waitForInterrupt();
+  enumerationTimeUpdate();
 
 #if DEBUG
-  Serial.write("setUSBMode(USBModeActive): 0x");
-  printHex(resetResult);
-  Serial.write("\n");
+  printMessageHex(MessageUSBModeActive, resetResult);
 #endif
 
   if (resetResult != USB_INT_CONNECT) {
 #if DEBUG
-  Serial.write("Failed to setup USB mode\n");
+  printMessage(MessageUSBModeFailed);
 #endif
     return false;
   }
@@ -136,11 +284,26 @@ bool handleConnect(struct HidInfo* hidInfo) {
     return false;
   }
 
+#if RUMBLE
+  rumbleReset();
+#endif
+  gOddPollParity = false;
+
+  gPollStats.enumerationMs = stopwatchMs(&gEnumerationTime);
+
   return true;
 }
 
+void recoveryReset() {
+  gRecovery.failureStreak = 0;
+  gRecovery.attempts = 0;
+  gRecovery.waiting = false;
+  gRecovery.backoff = RECOVERY_INITIAL_BACKOFF;
+}
+
 void handleDisconnect(struct HidInfo* hidInfo) {
   hidInfo->bootMouseEndpoint = 0;
+  recoveryReset();
   setUSBMode(USBModeIdle);
 }
 
@@ -152,40 +315,234 @@ void checkUsbInterupts(struct HidInfo* hidInfo) {
     usbWriteByte(GET_STATUS, false);
     uint8_t interrupt = usbReadByte();
 
-    Serial.write("GET_STATUS: 0x");
-    printHex(interrupt);
-    Serial.write("\n");
+    printMessageHex(MessageStatus, interrupt);
 
     switch (interrupt & 0x1F) {
       case USB_INT_CONNECT:
+        recoveryReset();
         handleConnect(hidInfo);
+#if DEBUG
+        // enumeration is the deepest the stack gets
+        printStackReport();
+#endif
         break;
       case USB_INT_DISCONNECT:
         handleDisconnect(hidInfo);
         break;
     }
 
-    // turn retries off for polling
-    setRetry(false);
+    // the new device's quirk decides how polling retries
+    usbSetPollRetry(hidInfo);
   }
 }
 
-bool gOddPollParity = false;
+uint8_t classifyPollStatus(uint8_t status) {
+  if (status == USB_INT_SUCCESS) {
+    return UsbPollResultReport;
+  }
+
+  if (status == USB_INT_DISCONNECT) {
+    return UsbPollResultDisconnect;
+  }
+
+  uint8_t pid = status & USB_INT_RET_PID;
+
+  if (status & USB_INT_RET_FAIL) {
+    switch (pid) {
+      case USB_PID_NAK:
+        return UsbPollResultNak;
+      case USB_PID_STALL:
+        return UsbPollResultStall;
+      case USB_PID_TIMEOUT:
+        return UsbPollResultTimeout;
+      case USB_PID_DATA0:
+      case USB_PID_DATA1:
+        // the device sent data with the wrong toggle, usually a repeat
+        // of a report whose ACK it missed
+        return UsbPollResultToggleError;
+    }
+
+    return UsbPollResultError;
+  }
+
+  // no interrupt at all
+  if (status == 0) {
+    return UsbPollResultTimeout;
+  }
+
+  return UsbPollResultError;
+}
+
+void usbSetPollRetry(struct HidInfo* hidInfo) {
+  setRetryMode((hidInfo->quirk.flags & QUIRK_POLL_RETRY) ? USB_RETRY_TIMEOUTS : USB_RETRY_OFF);
+}
 
-bool usbPollMouse(struct HidInfo* hidInfo, char* mouseData) {
+bool clearEndpointHalt(struct HidInfo* hidInfo) {
+  setRetry(true);
+  bool result = writeControlTransfer(0, REQUEST_TYPE_STANDARD | REQUEST_RECIPIENT_ENDPOINT, CLEAR_FEATURE, FEATURE_ENDPOINT_HALT, hidInfo->bootMouseEndpoint, 0, NULL);
+  usbSetPollRetry(hidInfo);
+  return result;
+}
+
+void recoveryFailedPoll(struct HidInfo* hidInfo) {
+  if (gRecovery.failureStreak == 0) {
+    stopwatchStart(&gRecoveryTime);
+  }
+
+  ++gRecovery.failureStreak;
+
+  if (gRecovery.failureStreak < POLL_FAILURE_LIMIT) {
+    return;
+  }
+
+  // stop polling until the device has been reset
+  hidInfo->bootMouseEndpoint = 0;
+  gRecovery.waiting = false;
+}
+
+void recoveryStep(struct HidInfo* hidInfo) {
+  stopwatchUpdate(&gRecoveryTime);
+
+  if (gRecovery.waiting && !timeReached(gRecovery.retryAt)) {
+    return;
+  }
+
+  if (gRecovery.attempts == RECOVERY_MAX_ATTEMPTS) {
+    // give up until the device is plugged in again
+    return;
+  }
+
+  ++gRecovery.attempts;
+
+#if DEBUG
+  printMessage(MessageResettingDevice);
+#endif
+
+  setRetry(true);
+  bool recovered = handleConnect(hidInfo);
+  usbSetPollRetry(hidInfo);
+
+  if (recovered) {
+    uint16_t recoveryMs = stopwatchMs(&gRecoveryTime);
+
+    ++gPollStats.recoveries;
+    gPollStats.lastRecoveryMs = recoveryMs;
+
+    if (recoveryMs > gPollStats.maxRecoveryMs) {
+      gPollStats.maxRecoveryMs = recoveryMs;
+    }
+
+    recoveryReset();
+    return;
+  }
+
+  ++gPollStats.failedRecoveries;
+
+  gRecovery.waiting = true;
+  gRecovery.retryAt = timeDeadline(gRecovery.backoff);
+
+  if (gRecovery.backoff < RECOVERY_MAX_BACKOFF) {
+    gRecovery.backoff <<= 1;
+  }
+
+  if (gRecovery.backoff > RECOVERY_MAX_BACKOFF) {
+    gRecovery.backoff = RECOVERY_MAX_BACKOFF;
+  }
+}
+
+bool usbPollMouse(struct HidInfo* hidInfo, struct ReportValues* values) {
   if (hidInfo->bootMouseEndpoint == 0) {
+    if (gRecovery.failureStreak >= POLL_FAILURE_LIMIT) {
+      recoveryStep(hidInfo);
+    }
+
     return false;
   }
 
-  if(!issueTokenRead(hidInfo->bootMouseEndpoint & 0x0F, DEF_USB_PID_IN, gOddPollParity)) {
-    return false;
+  if (gRecovery.failureStreak) {
+    stopwatchUpdate(&gRecoveryTime);
+  }
+
+  ++gPollStats.polls;
+
+  uint16_t pollStart = timeNow();
+
+  uint8_t status = issueTokenReadStatus(hidInfo->bootMouseEndpoint & 0x0F, DEF_USB_PID_IN, gOddPollParity);
+  uint8_t result = classifyPollStatus(status);
+
+  ++gPollStats.results[result];
+
+  switch (result) {
+    case UsbPollResultReport:
+      break;
+    case UsbPollResultNak:
+      // nothing new to report, the device is healthy
+      gRecovery.failureStreak = 0;
+      return false;
+    case UsbPollResultStall:
+      if (clearEndpointHalt(hidInfo)) {
+        ++gPollStats.clearHalts;
+        // clearing a halt resets the toggle to DATA0
+        gOddPollParity = false;
+      }
+      recoveryFailedPoll(hidInfo);
+      return false;
+    case UsbPollResultToggleError:
+      // the data was a repeat, expect the toggle after the one the device sent
+      gOddPollParity = (status & USB_INT_RET_PID) == USB_PID_DATA0;
+      recoveryFailedPoll(hidInfo);
+      return false;
+    case UsbPollResultDisconnect:
+      // the poll consumed the disconnect interrupt
+      handleDisconnect(hidInfo);
+      return false;
+    default:
+      recoveryFailedPoll(hidInfo);
+      return false;
+  }
+
+  gRecovery.failureStreak = 0;
+
+  uint8_t length;
+  bool decoded = reportDecoderRead(hidInfo, values, &length);
+
+  if (length > MAX_INPUT_REPORT_SIZE) {
+    // the extra bytes were dropped while reading
+    printMessage(MessageOverflow);
+    ++gPollStats.oversizeReports;
   }
 
-  if (usbReadBuffer(mouseData) > 8) {
-    Serial.write("Overflow!\n");
+  if (!decoded) {
+    ++gPollStats.undecodedReports;
   }
-  
+
   gOddPollParity = !gOddPollParity;
 
-  return true;
+  gPollStats.lastPollTicks = timeElapsed(pollStart);
+
+  if (gPollStats.lastPollTicks > gPollStats.maxPollTicks) {
+    gPollStats.maxPollTicks = gPollStats.lastPollTicks;
+  }
+
+  return decoded;
+}
+
+void usbResetPollStats() {
+  memset(&gPollStats, 0, sizeof(gPollStats));
+}
+
+struct UsbPollStats* usbGetPollStats() {
+  return &gPollStats;
+}
+
+uint16_t usbPollPeriod(struct HidInfo* hidInfo) {
+  uint8_t interval = hidInfo->pollInterval;
+
+  if (interval == 0) {
+    interval = DEFAULT_POLL_INTERVAL_MS;
+  } else if (interval > MAX_POLL_INTERVAL_MS) {
+    interval = MAX_POLL_INTERVAL_MS;
+  }
+
+  return TIME_MS(interval);
 }
\ No newline at end of file
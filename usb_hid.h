@@ -2,9 +2,63 @@
 #define __USB_HID_H__
 
 #include "descriptor_parser.h"
+#include "timebase.h"
+
+// consecutive failed polls before the device is reset and enumerated again
+#define POLL_FAILURE_LIMIT          8
+#define RECOVERY_MAX_ATTEMPTS       6
+// wait after the first failed recovery, doubles after each failure
+#define RECOVERY_INITIAL_BACKOFF    TIME_MS(8)
+#define RECOVERY_MAX_BACKOFF        TIME_MS(100)
+// time to hold the bus in reset
+#define USB_RESET_TIME_MS           40
+// used when the endpoint doesn't give a usable bInterval
+#define DEFAULT_POLL_INTERVAL_MS    1
+#define MAX_POLL_INTERVAL_MS        100
+
+enum UsbPollResult {
+  UsbPollResultReport,
+  UsbPollResultNak,
+  UsbPollResultStall,
+  UsbPollResultTimeout,
+  UsbPollResultToggleError,
+  UsbPollResultDisconnect,
+  UsbPollResultError,
+
+  UsbPollResultCount,
+};
+
+struct UsbPollStats {
+  uint16_t polls;
+  uint16_t results[UsbPollResultCount];
+  uint16_t clearHalts;
+  // reports longer than MAX_INPUT_REPORT_SIZE, the rest was dropped
+  uint16_t oversizeReports;
+  // reports too short for the layout or with the wrong report id
+  uint16_t undecodedReports;
+  uint16_t recoveries;
+  uint16_t failedRecoveries;
+  // time from the first failure to a working device again
+  uint16_t lastRecoveryMs;
+  uint16_t maxRecoveryMs;
+  // reset to a working device, including descriptor reads
+  uint16_t enumerationMs;
+  // time spent fetching a report, in timebase ticks
+  uint16_t lastPollTicks;
+  uint16_t maxPollTicks;
+};
 
 uint8_t usbUnit();
 void checkUsbInterupts(struct HidInfo* hidInfo);
-bool usbPollMouse(struct HidInfo* hidInfo, char* mouseData);
+// polls the device's input endpoint and decodes the report straight off
+// the bus, returns false if there was no report
+bool usbPollMouse(struct HidInfo* hidInfo, struct ReportValues* values);
+struct UsbPollStats* usbGetPollStats();
+// puts the CH375B's retries back how polling wants them after a control
+// transfer turned them on, off unless the device's quirk says otherwise
+void usbSetPollRetry(struct HidInfo* hidInfo);
+void usbResetPollStats();
+// time between polls the device asked for, in timebase ticks
+uint16_t usbPollPeriod(struct HidInfo* hidInfo);
 
 #endif
\ No newline at end of file
@@ -3,98 +3,16 @@
 #include <Arduino.h>
 
 #include "debug_print.h"
-
-void usbWriteByte(uint8_t byte, bool isData) {
-  // needed to space commands out
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-
-  if (isData) {
-    // send data
-    DDRD |= USB_A0;
-  } else {
-    // send command
-    DDRD &= ~USB_A0;
-  }
-
-  // configure the output pins 
-  DDRC = ((~byte & 0xE0) >> 5) | (DDRC & 0xF8);
-  // DDRC |= 0x07;
-  DDRB = (~byte) & 0x1F;
-
-  // trigger write
-  DDRD |= USB_WR;
-  DDRD &= ~USB_WR;
-  // needed to allow USB chip to finish reading
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-
-  DDRB = 0x00;
-  DDRC &= 0xF8;
-}
-
-uint8_t usbReadByte() {
-  // needed to space commands out
-  delayMicroseconds(3);
-
-  // configure the data line to be input pins and configure USB_A0 to read
-  DDRD |= USB_A0;
-
-  DDRB = 0x00;
-  DDRC &= 0xF8;
-
-  // trigger read
-  DDRD |= USB_RD;
-  // needed to let inputs stabilize
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-  asm volatile ("nop");
-
-  // read data
-  uint8_t result = (PINB & 0x1F) | ((PINC & 0x07) << 5);
-
-  // turn off read signal
-  DDRD &= ~USB_RD;
-
-  return result;
-}
-
-uint8_t usbReadBuffer(uint8_t* buffer) {
-  usbWriteByte(RD_USB_DATA, false);
-  uint8_t result = usbReadByte();
-
-  for (uint8_t i = 0; i < result; ++i) {
-    buffer[i] = usbReadByte();
-  }
-
-  return result;
-}
-
-#define MAX_ATTEMPTS 10000
+#include "messages.h"
+#include "timebase.h"
 
 uint8_t waitForInterrupt() {
-  uint16_t attempt = 0;
+  uint16_t deadline = timeDeadline(USB_INTERRUPT_TIMEOUT);
+
   while ((PIND & USB_INT)) {
-    if (attempt == MAX_ATTEMPTS) {
+    if (timeReached(deadline)) {
       return 0;
     }
-
-    ++attempt;
   }
 
   usbWriteByte(GET_STATUS, false);
@@ -108,12 +26,12 @@ bool issueToken(uint8_t endpoint, uint8_t packetType, bool oddParity) {
   return waitForInterrupt() == USB_INT_SUCCESS;
 }
 
-bool issueTokenRead(uint8_t endpoint, uint8_t packetType, bool oddParity) {
+uint8_t issueTokenReadStatus(uint8_t endpoint, uint8_t packetType, bool oddParity) {
   usbWriteByte(ISSUE_TKN_X, false);
   usbWriteByte(oddParity ? 0x40 : 0x00, true);
   usbWriteByte((endpoint << 4) | packetType, true);
 
-  return waitForInterrupt() == USB_INT_SUCCESS;
+  return waitForInterrupt();
 }
 
 #define READ_PACKET_SIZE    8
@@ -145,7 +63,7 @@ bool readControlTransfer(uint8_t endpoint, uint8_t bmRequestType, uint8_t bReque
   while (wLength > 0) {
     if (!issueToken(endpoint, DEF_USB_PID_IN, oddParity)) {
 #if DEBUG
-  Serial.print("Failed to get input data\n");
+  printMessage(MessageInputFailed);
 #endif
       return false;
     }
@@ -224,12 +142,11 @@ bool writeControlTransfer(uint8_t endpoint, uint8_t bmRequestType, uint8_t bRequ
       ++offset;
     }
 
-    usbWriteByte(WR_USB_DATA7, false);
-    usbWriteByte(0, true);
+    wLength -= chunkSize;
 
     if (!issueToken(endpoint, DEF_USB_PID_OUT, oddParity)) {
 #if DEBUG
-  Serial.print("Failed to get input data\n");
+  printMessage(MessageOutputFailed);
 #endif
       return false;
     }
@@ -237,7 +154,20 @@ bool writeControlTransfer(uint8_t endpoint, uint8_t bmRequestType, uint8_t bRequ
     oddParity = !oddParity;
   }
 
-  return issueToken(endpoint, DEF_USB_PID_IN, oddParity);
+  // status stage, same toggle as a transfer with no data stage
+  return issueToken(endpoint, DEF_USB_PID_IN, true);
+}
+
+bool writeInterruptTransfer(uint8_t endpoint, bool oddParity, char* toSend, uint8_t length) {
+  usbWriteByte(WR_USB_DATA7, false);
+  // number of bytes coming
+  usbWriteByte(length, true);
+
+  for (uint8_t i = 0; i < length; ++i) {
+    usbWriteByte(toSend[i], true);
+  }
+
+  return issueToken(endpoint, DEF_USB_PID_OUT, oddParity);
 }
 
 void setUSBMode(uint8_t mode) {
@@ -246,8 +176,11 @@ void setUSBMode(uint8_t mode) {
 }
 
 void setRetry(bool shouldRetry) {
+  setRetryMode(shouldRetry ? USB_RETRY_ALL : USB_RETRY_OFF);
+}
+
+void setRetryMode(uint8_t mode) {
   usbWriteByte(SET_RETRY, false);
   usbWriteByte(0x25, true);
-  usbWriteByte(shouldRetry ? 0x85 : 0x00, true);
-
+  usbWriteByte(mode, true);
 }
\ No newline at end of file
@@ -4,6 +4,32 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// how commands get to the CH375B
+//   USB_TRANSPORT_PARALLEL - 8 bit data bus plus RD, WR and A0, see the pin map below
+//   USB_TRANSPORT_UART - the CH375B serial interface on the hardware UART.
+//     Serial can't be used for debug output in this mode.
+#define USB_TRANSPORT_PARALLEL  0
+#define USB_TRANSPORT_UART      1
+
+#define USB_TRANSPORT           USB_TRANSPORT_PARALLEL
+
+// the CH375B serial port runs at 9600 after power on and RESET_ALL, it's
+// moved to USB_UART_BAUD once it answers. At 9600 a single poll takes
+// about 16ms on the wire, too slow to keep up with the N64.
+#define USB_UART_RESET_BAUD     9600
+#define USB_UART_BAUD           115200
+// SET_BAUDRATE divisor coefficient and constant for USB_UART_BAUD, from
+// the table in the CH375 datasheet, change them together
+#define USB_UART_BAUD_COEFF     0x03
+#define USB_UART_BAUD_CONST     0xCC
+
+// size of the CH375B's data buffer, no packet can be longer
+#define USB_MAX_PACKET_SIZE     64
+
+// how long to wait for the CH375B to finish a command, in timebase ticks
+#define USB_INTERRUPT_TIMEOUT   TIME_MS(5)
+
+// parallel transport pins
 // PORTB
 //     0 USB-D0 - input
 //     1 USB-D1 - input
@@ -25,8 +51,8 @@
 //     5 SDL - managed by wire library
 
 // PORTD
-//     0 RSX - input
-//     1 TSX - output
+//     0 RSX - input, CH375B TXD in UART mode
+//     1 TSX - output, CH375B RXD in UART mode
 //     2 N64 - input
 //     3 USB-INT - input
 #define USB_INT     (1 << 3)
@@ -39,6 +65,7 @@
 //     7 
 
 #define GET_IC_VER    0x01
+#define SET_BAUDRATE  0x02
 #define RESET_ALL     0x05
 #define CHECK_EXIST   0x06
 #define SET_RETRY     0x0B
@@ -56,6 +83,8 @@
 #define ISSUE_TKN_X   0x4E
 #define ISSUE_TOKEN   0x4F
 
+// command status for SET_BAUDRATE
+#define CMD_RET_SUCCESS     0x51
 
 // possible values for GET_STATUS
 #define USB_INT_SUCCESS     0x14
@@ -63,6 +92,21 @@
 #define USB_INT_DISCONNECT  0x16
 #define USB_INT_BUF_OVER    0x17
 
+// a failed transaction reports 0x20 | the PID the device answered with.
+// Data with the wrong toggle is a failure with a DATA0 or DATA1 PID, like
+// 0x2B or 0x3B.
+#define USB_INT_RET_FAIL    0x20
+// the chip's toggle sync flag, the PID alone says which toggle was sent
+#define USB_INT_RET_SYNC    0x10
+#define USB_INT_RET_PID     0x0F
+
+// PIDs reported in the low bits of a failed status, 0 means no response
+#define USB_PID_TIMEOUT     0x00
+#define USB_PID_DATA0       0x03
+#define USB_PID_DATA1       0x0B
+#define USB_PID_NAK         0x0A
+#define USB_PID_STALL       0x0E
+
 #define DEF_USB_PID_SETUP   0xD
 #define DEF_USB_PID_OUT     0x1
 #define DEF_USB_PID_IN      0x9
@@ -92,15 +136,26 @@ typedef void (*PacketHandler)(void* data, char* packetData, uint8_t packetSize,
 #define REQUEST_RECIPIENT_OTHER     0x03
 
 // device request types
+#define CLEAR_FEATURE       0x01
 #define GET_DESCRIPTOR      0x06
 #define SET_CONFIGURATION   0x09
 
 // interface request types
 #define SET_PROTOCOL        0x0B
 
+// feature selectors
+#define FEATURE_ENDPOINT_HALT   0x00
+
 #define SET_PROTOCOL_BOOT   0x00
 #define SET_PROTOCOL_REPORT 0x01
 
+// SET_RETRY modes, bit 7 retries NAKs until the device answers and the
+// low bits are how many times a timeout is retried
+#define USB_RETRY_OFF       0x00
+#define USB_RETRY_ALL       0x85
+// NAKs still come straight back so polling isn't held up
+#define USB_RETRY_TIMEOUTS  0x05
+
 #define PACK_WORD_BYTES(a, b)   ((uint16_t)(b) | ((uint16_t)(a) << 8))
 
 enum USBMode {
@@ -109,15 +164,20 @@ enum USBMode {
   USBModeActive = 0x06,
 };
 
+// implemented by the selected transport
+void usbBusInit();
+// called after RESET_ALL, moves the bus to its running speed
+void usbBusSetSpeed();
 void usbWriteByte(uint8_t byte, bool isData);
 uint8_t usbReadByte();
-uint8_t usbReadBuffer(uint8_t* buffer);
-bool issueTokenRead(uint8_t endpoint, uint8_t packetType, bool oddParity);
+uint8_t issueTokenReadStatus(uint8_t endpoint, uint8_t packetType, bool oddParity);
 uint8_t waitForInterrupt();
 bool readControlTransfer(uint8_t endpoint, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, void* data, PacketHandler packetHandler);
 bool writeControlTransfer(uint8_t endpoint, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, char* toSend);
+bool writeInterruptTransfer(uint8_t endpoint, bool oddParity, char* toSend, uint8_t length);
 void setUSBMode(uint8_t mode);
 void setRetry(bool shouldRetry);
+void setRetryMode(uint8_t mode);
 
 void printHex(uint8_t);
 void debugPrintBuffer(uint8_t* data, uint8_t bytes);